@@ -0,0 +1,135 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <utility>
+#include <cstddef>
+
+
+// 无锁有界队列
+// 容量向上取整为2的幂。try_push只在成功时移走元素，失败时调用方可以原样重试，
+// 由调用方决定等待策略，队列满时的等待即形成对上游的反压。
+
+namespace queue_detail
+{
+    // 避免生产者与消费者的下标落在同一缓存行上产生伪共享
+    constexpr size_t CACHE_LINE = 64;
+
+    inline size_t round_up_pow2(size_t n) {
+        if (n < 2)
+            return 2;
+        size_t result = 1;
+        while (result < n)
+            result <<= 1;
+        return result;
+    }
+}
+
+
+// 单生产者单消费者环形队列
+template <typename T>
+class SpscQueue {
+private:
+    const size_t mask_;
+    ::std::vector<T> slots_;
+    alignas(queue_detail::CACHE_LINE) ::std::atomic<size_t> head_{0};   // 消费者读取位置
+    alignas(queue_detail::CACHE_LINE) ::std::atomic<size_t> tail_{0};   // 生产者写入位置
+
+public:
+    explicit SpscQueue(size_t capacity) :
+    mask_(queue_detail::round_up_pow2(capacity) - 1),
+    slots_(mask_ + 1) {}
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue &operator=(const SpscQueue&) = delete;
+
+    bool try_push(T &item) {
+        const size_t tail = tail_.load(::std::memory_order_relaxed);
+        if (tail - head_.load(::std::memory_order_acquire) > mask_)
+            return false;
+        slots_[tail & mask_] = ::std::move(item);
+        tail_.store(tail + 1, ::std::memory_order_release);
+        return true;
+    }
+
+    bool try_pop(T &item) {
+        const size_t head = head_.load(::std::memory_order_relaxed);
+        if (head == tail_.load(::std::memory_order_acquire))
+            return false;
+        item = ::std::move(slots_[head & mask_]);
+        head_.store(head + 1, ::std::memory_order_release);
+        return true;
+    }
+
+    size_t capacity() const { return mask_ + 1; }
+};
+
+
+// 多生产者多消费者队列（Dmitry Vyukov的有界队列）
+// 每个槽位带一个序号，生产者和消费者各自用CAS抢占下标，再按序号判断槽位是否可用。
+template <typename T>
+class MpmcQueue {
+private:
+    struct Cell {
+        ::std::atomic<size_t> sequence;
+        T data;
+    };
+
+    const size_t mask_;
+    ::std::unique_ptr<Cell[]> cells_;
+    alignas(queue_detail::CACHE_LINE) ::std::atomic<size_t> enqueue_pos_{0};
+    alignas(queue_detail::CACHE_LINE) ::std::atomic<size_t> dequeue_pos_{0};
+
+public:
+    explicit MpmcQueue(size_t capacity) :
+    mask_(queue_detail::round_up_pow2(capacity) - 1),
+    cells_(::std::make_unique<Cell[]>(mask_ + 1)) {
+        for (size_t i = 0; i <= mask_; ++i)
+            cells_[i].sequence.store(i, ::std::memory_order_relaxed);
+    }
+
+    MpmcQueue(const MpmcQueue&) = delete;
+    MpmcQueue &operator=(const MpmcQueue&) = delete;
+
+    bool try_push(T &item) {
+        size_t pos = enqueue_pos_.load(::std::memory_order_relaxed);
+        for (;;) {
+            Cell &cell = cells_[pos & mask_];
+            const size_t sequence = cell.sequence.load(::std::memory_order_acquire);
+            const auto diff = static_cast<::std::ptrdiff_t>(sequence) - static_cast<::std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, ::std::memory_order_relaxed)) {
+                    cell.data = ::std::move(item);
+                    cell.sequence.store(pos + 1, ::std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueue_pos_.load(::std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool try_pop(T &item) {
+        size_t pos = dequeue_pos_.load(::std::memory_order_relaxed);
+        for (;;) {
+            Cell &cell = cells_[pos & mask_];
+            const size_t sequence = cell.sequence.load(::std::memory_order_acquire);
+            const auto diff = static_cast<::std::ptrdiff_t>(sequence) - static_cast<::std::ptrdiff_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, ::std::memory_order_relaxed)) {
+                    item = ::std::move(cell.data);
+                    cell.sequence.store(pos + mask_ + 1, ::std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = dequeue_pos_.load(::std::memory_order_relaxed);
+            }
+        }
+    }
+
+    size_t capacity() const { return mask_ + 1; }
+};
@@ -0,0 +1,136 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
+#include <optional>
+#include <iterator>
+#include <limits>
+#include <cstdint>
+#include <cstddef>
+
+
+// 只读紧凑字典
+// 键按字典序排序后每BUCKET_SIZE个分为一桶，桶内首键完整保存，其余键只保存与前一个键
+// 的公共前缀长度和剩余后缀（前缀编码），长度均为LEB128变长整数。键的32位编号即其排序
+// 后的序号。所有键和值的字节都放在同一块连续内存中，适合构建后只做查询的分词路径。
+class CompactDict {
+public:
+    static constexpr size_t BUCKET_SIZE = 16;
+
+    struct PrefixEntry
+    {
+        uint32_t id;
+        ::std::string_view key;     // 指向迭代器内部缓冲区，迭代器前进后失效
+    };
+
+    // 按字典序逐个解码以某前缀开头的键，每前进一步只解码一个键
+    class PrefixIterator {
+    public:
+        using iterator_category = ::std::input_iterator_tag;
+        using value_type = PrefixEntry;
+        using difference_type = ::std::ptrdiff_t;
+        using pointer = void;
+        using reference = PrefixEntry;
+
+        PrefixIterator() = default;
+
+        reference operator*() const { return PrefixEntry{id_, key_}; }
+        PrefixIterator &operator++();
+
+        bool operator==(const PrefixIterator &other) const {
+            return done_ == other.done_ && (done_ || id_ == other.id_);
+        }
+        bool operator!=(const PrefixIterator &other) const { return !(*this == other); }
+
+    private:
+        friend class CompactDict;
+
+        const CompactDict *dict_ = nullptr;
+        ::std::string prefix_;
+        const char *next_ = nullptr;    // 下一个键的编码位置
+        size_t remaining_ = 0;          // 还可以返回的键数
+        ::std::string key_;
+        uint32_t id_ = 0;
+        bool done_ = true;
+
+        // 检查当前键是否仍在前缀范围内
+        void settle();
+    };
+
+    // prefix_range的返回值，只保存查询的起点，遍历时才逐个解码
+    class PrefixRange {
+    public:
+        PrefixIterator begin() const;
+        PrefixIterator end() const { return PrefixIterator(); }
+
+    private:
+        friend class CompactDict;
+
+        const CompactDict *dict_ = nullptr;
+        ::std::string prefix_;
+        uint32_t first_ = 0;
+        size_t limit_ = 0;
+    };
+
+    CompactDict();
+
+    // 由键值对构建，重复的键以最后一次出现为准；keep_values为false时只保存键
+    explicit CompactDict(
+        ::std::vector<::std::pair<::std::string, ::std::string>> entries,
+        bool keep_values = true
+    );
+
+    // 查找键的编号，不存在则返回空
+    ::std::optional<uint32_t> find(::std::string_view key) const;
+
+    bool contains(::std::string_view key) const { return find(key).has_value(); }
+
+    // 获取键对应的值，不存在或未保存值时返回空
+    ::std::optional<::std::string_view> get(::std::string_view key) const;
+
+    // 按编号还原键
+    ::std::string key_at(uint32_t id) const;
+
+    // 按编号获取值，未保存值时返回空串
+    ::std::string_view value_at(uint32_t id) const;
+
+    // 按字典序返回以prefix开头的前limit个键
+    // 定位起点需要在桶首键上二分并在桶内最多解码BUCKET_SIZE个键，之后每个结果只需解码一次
+    PrefixRange prefix_range(
+        ::std::string_view prefix,
+        size_t limit = ::std::numeric_limits<size_t>::max()
+    ) const;
+
+    size_t size() const { return size_; }
+
+    // 字典占用的总字节数
+    size_t memory_usage() const;
+
+    // 字典内容的代际编号，每次构建时领取，供分词缓存判断是否失效
+    uint64_t generation() const { return generation_; }
+
+    void info() const;
+
+private:
+    ::std::string blob_;                    // 前缀编码的键，随后是所有值
+    ::std::vector<uint32_t> buckets_;       // 每个桶首键在blob_中的位置
+    ::std::vector<uint32_t> values_;        // 第i个值位于blob_[values_[i], values_[i+1])
+    uint32_t size_ = 0;
+    uint64_t generation_;
+
+    // 读取桶的首键
+    ::std::string_view bucket_head(size_t bucket) const;
+
+    // 返回首键不大于key的最后一个桶，key比所有首键都小时返回buckets_.size()
+    size_t locate_bucket(::std::string_view key) const;
+
+    // 在key中保存的前一个键的基础上解码编号为id的键，返回下一个键的编码位置
+    const char *decode_next(const char *p, uint32_t id, ::std::string &key) const;
+
+    // 解码编号为id的键，返回下一个键的编码位置
+    const char *seek(uint32_t id, ::std::string &key) const;
+
+    // 返回第一个不小于key的键的编号，不存在时返回size()
+    uint32_t lower_bound(::std::string_view key) const;
+};
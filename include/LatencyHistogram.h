@@ -0,0 +1,92 @@
+#pragma once
+#include <array>
+#include <iostream>
+#include <iomanip>
+#include <cstdint>
+
+
+// 对数线性分桶的延迟直方图（单位纳秒）
+// 每个2的幂区间再细分16个子桶，相对误差约6%，内存固定，适合长时间运行的服务。
+class LatencyHistogram {
+private:
+    static constexpr int SUB_BITS = 4;
+    static constexpr uint64_t SUB_COUNT = 1ull << SUB_BITS;
+    static constexpr size_t BUCKET_COUNT = 64 * SUB_COUNT;
+
+    ::std::array<uint64_t, BUCKET_COUNT> buckets_{};
+    uint64_t count_ = 0;
+    uint64_t sum_ = 0;
+    uint64_t max_ = 0;
+
+    static size_t bucket_of(uint64_t value) {
+        if (value < SUB_COUNT)
+            return static_cast<size_t>(value);
+        int msb = 0;
+        while (value >> (msb + 1))
+            ++msb;
+        const int shift = msb - SUB_BITS;
+        return (static_cast<size_t>(shift + 1) << SUB_BITS) + ((value >> shift) & (SUB_COUNT - 1));
+    }
+
+    // 桶内最大值
+    static uint64_t upper_bound_of(size_t bucket) {
+        if (bucket < SUB_COUNT)
+            return bucket;
+        const int shift = static_cast<int>(bucket >> SUB_BITS) - 1;
+        const uint64_t mantissa = SUB_COUNT + (bucket & (SUB_COUNT - 1));
+        return ((mantissa + 1) << shift) - 1;
+    }
+
+public:
+    void record(uint64_t nanoseconds) {
+        ++buckets_[bucket_of(nanoseconds)];
+        ++count_;
+        sum_ += nanoseconds;
+        if (nanoseconds > max_)
+            max_ = nanoseconds;
+    }
+
+    void merge(const LatencyHistogram &other) {
+        for (size_t i = 0; i < BUCKET_COUNT; ++i)
+            buckets_[i] += other.buckets_[i];
+        count_ += other.count_;
+        sum_ += other.sum_;
+        if (other.max_ > max_)
+            max_ = other.max_;
+    }
+
+    uint64_t count() const { return count_; }
+    uint64_t max() const { return max_; }
+    double mean() const { return count_ == 0 ? 0.0 : static_cast<double>(sum_) / static_cast<double>(count_); }
+
+    // 返回第p百分位（0~100）的延迟上界
+    uint64_t percentile(double p) const {
+        if (count_ == 0)
+            return 0;
+        uint64_t rank = static_cast<uint64_t>(p / 100.0 * static_cast<double>(count_) + 0.5);
+        if (rank < 1)
+            rank = 1;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+            seen += buckets_[i];
+            if (seen >= rank)
+                return upper_bound_of(i) < max_ ? upper_bound_of(i) : max_;
+        }
+        return max_;
+    }
+
+    void info(const char *title) const {
+        const auto us = [](double ns) { return ns / 1000.0; };
+        ::std::cout
+            << title << " Latency (μs):\n"
+            << ::std::fixed << ::std::setprecision(2)
+            << "Count=" << count_
+            << ", Mean=" << us(mean())
+            << ", P50=" << us(static_cast<double>(percentile(50)))
+            << ", P90=" << us(static_cast<double>(percentile(90)))
+            << ", P99=" << us(static_cast<double>(percentile(99)))
+            << ", P99.9=" << us(static_cast<double>(percentile(99.9)))
+            << ", Max=" << us(static_cast<double>(max_)) << "\n\n"
+            << ::std::defaultfloat << ::std::setprecision(6);
+    }
+};
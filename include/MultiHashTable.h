@@ -1,3 +1,4 @@
+#pragma once
 #include <optional>
 #include <string>
 #include <vector>
@@ -14,6 +15,26 @@
 #include <memory>
 #include <map>
 #include <tuple>
+#include <atomic>
+#include <cstdint>
+
+
+// 字典代际编号：全局单调递增，字典内容每次变化都领取一个新编号，
+// 分词缓存据此判断缓存结果是否已经失效
+inline uint64_t next_dictionary_generation() {
+    static ::std::atomic<uint64_t> counter{0};
+    return ++counter;
+}
+
+
+// 估算对象在堆上额外占用的字节数，用于统计内存占用
+template <typename T>
+size_t heap_bytes(const T &) { return 0; }
+
+inline size_t heap_bytes(const ::std::string &str) {
+    // 只有超出短字符串优化的容量时才会在堆上分配
+    return str.capacity() > ::std::string().capacity() ? str.capacity() + 1 : 0;
+}
 
 
 template <typename Key, typename Value>
@@ -135,6 +156,16 @@ public:
     }
 
     const size_t size() const { return table_size_; }
+
+    // 槽位数组与已填充键值对在堆上的字节数
+    size_t memory_usage() const {
+        size_t total = table_size_ * sizeof(::std::optional<::std::pair<Key, Value>>);
+        for (size_t i = 0; i < table_size_; ++i) {
+            if (buckets_[i].has_value())
+                total += heap_bytes(buckets_[i]->first) + heap_bytes(buckets_[i]->second);
+        }
+        return total;
+    }
 };
 
 
@@ -144,6 +175,7 @@ class MultiHashTable {
 private:
     ::std::vector<HashTable<Key, Value>> tables_;           
     ::std::map<Key, Value> overflow_entries_;
+    uint64_t generation_ = next_dictionary_generation();
 
     bool is_prime(size_t n) const
     {
@@ -215,6 +247,7 @@ public:
 
 
     void erase(const Key &key) {
+        generation_ = next_dictionary_generation();
         const size_t hash_value = ::std::hash<Key>{}(key);
         for (auto &table : tables_) {
             const size_t pos = hash_value % table.size();
@@ -229,6 +262,7 @@ public:
 
 
     void insert(const ::std::pair<Key, Value> &pair) {
+        generation_ = next_dictionary_generation();
         const size_t hash_value = ::std::hash<Key>{}(pair.first);
         for (auto &table : tables_) {
             const size_t pos = hash_value % table.size();
@@ -241,6 +275,7 @@ public:
     }
 
     void clear(void) {
+        generation_ = next_dictionary_generation();
         for (auto &table : tables_) {
             table.clear();
         }
@@ -248,6 +283,10 @@ public:
     }
 
 
+    // 当前字典内容的代际编号，插入、删除、清空后都会改变
+    uint64_t generation() const { return generation_; }
+
+
     const ::std::tuple<size_t, size_t> size() const {
         size_t total = 0;
         for (const auto &table : tables_)
@@ -256,6 +295,33 @@ public:
     }
 
 
+    // 遍历所有键值对，先按层和槽位顺序，最后是溢出区，顺序与键的大小无关
+    template <typename Func>
+    void for_each(Func &&func) const {
+        for (const auto &table : tables_) {
+            for (size_t i = 0; i < table.size(); ++i) {
+                const auto &slot = table.at(i);
+                if (slot.has_value())
+                    func(slot->first, slot->second);
+            }
+        }
+        for (const auto &entry : overflow_entries_)
+            func(entry.first, entry.second);
+    }
+
+
+    // 估算总内存占用，包括各层槽位、字符串的堆分配以及溢出区红黑树的节点
+    size_t memory_usage() const {
+        constexpr size_t MAP_NODE_OVERHEAD = 4 * sizeof(void *);
+        size_t total = sizeof(*this) + tables_.capacity() * sizeof(HashTable<Key, Value>);
+        for (const auto &table : tables_)
+            total += table.memory_usage();
+        for (const auto &entry : overflow_entries_)
+            total += sizeof(entry) + MAP_NODE_OVERHEAD + heap_bytes(entry.first) + heap_bytes(entry.second);
+        return total;
+    }
+
+
     void info() const {
         size_t total_used = 0;
         size_t total_size = 0;
@@ -0,0 +1,51 @@
+#pragma once
+#include "Segmenter.h"
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+
+// 流水线分词：读取 -> UTF-8校验 -> 分词（多线程） -> 按序写出
+// 各阶段之间以无锁有界队列相连，队列满时上游等待形成反压，I/O与计算可以重叠进行，
+// 大文件的总耗时趋近于最慢阶段的耗时而不是各阶段耗时之和。
+
+struct PipelineOptions
+{
+    size_t workers = 0;                 // 分词线程数，0表示使用硬件线程数减去其它阶段
+    size_t queue_capacity = 64;         // 每个队列最多缓存的块数，也是写出阶段重排窗口的块数
+    size_t chunk_lines = 256;           // 每块最多行数
+    size_t chunk_bytes = 64 * 1024;     // 每块最多字节数
+    size_t read_block = 1 << 20;        // 每次从输入读取的字节数
+};
+
+// 单个阶段的运行统计，时间单位为毫秒，多线程阶段为各线程之和
+struct StageStats
+{
+    ::std::string name;
+    size_t threads = 1;
+    uint64_t items = 0;         // 处理的块数
+    double busy_ms = 0;         // 实际工作时间
+    double starved_ms = 0;      // 等待上游输入的时间
+    double blocked_ms = 0;      // 因下游队列已满而等待的时间
+};
+
+struct PipelineReport
+{
+    ::std::vector<StageStats> stages;
+    double wall_ms = 0;
+    uint64_t lines = 0;
+    uint64_t invalid_lines = 0;     // 含非法UTF-8序列、已替换为U+FFFD的行数
+
+    void info() const;
+};
+
+
+// 从in逐行读取句子（跳过空行），分词后以与逐句处理相同的格式按原顺序写入out
+PipelineReport run_pipeline(
+    ::std::istream &in,
+    ::std::ostream &out,
+    const Segmenter &segmenter,
+    const PipelineOptions &options = PipelineOptions()
+);
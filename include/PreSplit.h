@@ -1,4 +1,7 @@
+#pragma once
 #include "MultiHashTable.h"
+#include "SegmentCache.h"
+#include "CompactDict.h"
 #include <string>
 #include <codecvt>
 #include <locale>
@@ -9,6 +12,9 @@
 ::std::wstring utf8_to_unicode(const ::std::string &utf8_str);
 ::std::string unicode_to_utf8(const ::std::wstring &wide_str);
 
+// 将非法的UTF-8序列替换为U+FFFD，返回被替换的序列数
+size_t sanitize_utf8(::std::string &text);
+
 struct MatchInfo
 {
     ::std::wstring longest_match = L"";   // 最长匹配子串
@@ -25,8 +31,33 @@ MatchInfo find_max_match(
     size_t start_pos
 );
 
+MatchInfo find_max_match(
+    const CompactDict &dict,
+    const ::std::wstring &sentence,
+    size_t start_pos
+);
+
 
 ::std::vector<std::string> MaxiumSplit(
     const MultiHashTable<::std::string, ::std::string> &table,
     const ::std::string &sentence
+);
+
+::std::vector<std::string> MaxiumSplit(
+    const CompactDict &dict,
+    const ::std::string &sentence
+);
+
+
+// 带缓存的分词函数，缓存结果随字典代际编号失效
+::std::vector<std::string> MaxiumSplit(
+    const MultiHashTable<::std::string, ::std::string> &table,
+    const ::std::string &sentence,
+    SegmentCache &cache
+);
+
+::std::vector<std::string> MaxiumSplit(
+    const CompactDict &dict,
+    const ::std::string &sentence,
+    SegmentCache &cache
 );
\ No newline at end of file
@@ -0,0 +1,116 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <optional>
+#include <cstdint>
+#include <cstddef>
+
+
+// 分词服务的二进制协议
+// 每一帧为 4字节小端长度 + 负载。请求负载为一个UTF-8句子；
+// 响应负载以4字节状态码开头：
+//   STATUS_OK    之后为 4字节词数n + n个4字节词长 + 依次拼接的词字节；
+//   其它状态码   之后为UTF-8错误信息，该请求没有分词结果，连接仍可继续使用。
+// 因此分词失败与空句子的空结果可以区分。
+// 同一连接上可以连续发送多个请求（流水线），响应严格按请求顺序返回。
+namespace seg_protocol
+{
+    constexpr size_t HEADER_SIZE = 4;
+    constexpr uint32_t MAX_FRAME_SIZE = 1u << 24; // 单帧负载上限
+
+    constexpr uint32_t STATUS_OK = 0;
+    constexpr uint32_t STATUS_SEGMENT_ERROR = 1;  // 分词过程中抛出异常
+
+    struct Response
+    {
+        uint32_t status = STATUS_OK;
+        ::std::vector<::std::string> words;   // 仅status为STATUS_OK时有效
+        ::std::string error;                  // 仅status不为STATUS_OK时有效
+    };
+
+    inline void append_u32(::std::string &out, uint32_t value) {
+        out.push_back(static_cast<char>(value & 0xff));
+        out.push_back(static_cast<char>((value >> 8) & 0xff));
+        out.push_back(static_cast<char>((value >> 16) & 0xff));
+        out.push_back(static_cast<char>((value >> 24) & 0xff));
+    }
+
+    inline uint32_t read_u32(const char *data) {
+        const auto *p = reinterpret_cast<const unsigned char *>(data);
+        return static_cast<uint32_t>(p[0])
+            | (static_cast<uint32_t>(p[1]) << 8)
+            | (static_cast<uint32_t>(p[2]) << 16)
+            | (static_cast<uint32_t>(p[3]) << 24);
+    }
+
+    // 将一个请求帧追加到out
+    inline void encode_request(::std::string &out, const ::std::string &sentence) {
+        append_u32(out, static_cast<uint32_t>(sentence.size()));
+        out += sentence;
+    }
+
+    // 将一个响应帧追加到out
+    inline void encode_response(::std::string &out, const ::std::vector<::std::string> &words) {
+        size_t payload = 2 * HEADER_SIZE + HEADER_SIZE * words.size();
+        for (const auto &word : words)
+            payload += word.size();
+        out.reserve(out.size() + HEADER_SIZE + payload);
+        append_u32(out, static_cast<uint32_t>(payload));
+        append_u32(out, STATUS_OK);
+        append_u32(out, static_cast<uint32_t>(words.size()));
+        for (const auto &word : words)
+            append_u32(out, static_cast<uint32_t>(word.size()));
+        for (const auto &word : words)
+            out += word;
+    }
+
+    // 将一个错误响应帧追加到out
+    inline void encode_error(::std::string &out, uint32_t status, const ::std::string &message) {
+        append_u32(out, static_cast<uint32_t>(HEADER_SIZE + message.size()));
+        append_u32(out, status);
+        out += message;
+    }
+
+    // 若buffer从offset起包含一个完整帧，返回负载长度；数据不足时返回空
+    inline ::std::optional<uint32_t> peek_frame(const ::std::string &buffer, size_t offset) {
+        if (buffer.size() - offset < HEADER_SIZE)
+            return ::std::nullopt;
+        const uint32_t length = read_u32(buffer.data() + offset);
+        if (buffer.size() - offset - HEADER_SIZE < length)
+            return ::std::nullopt;
+        return length;
+    }
+
+    // 解析响应负载，格式错误时返回空
+    inline ::std::optional<Response> decode_response(const char *data, size_t length) {
+        if (length < HEADER_SIZE)
+            return ::std::nullopt;
+        Response response;
+        response.status = read_u32(data);
+        data += HEADER_SIZE;
+        length -= HEADER_SIZE;
+        if (response.status != STATUS_OK) {
+            response.error.assign(data, length);
+            return response;
+        }
+
+        if (length < HEADER_SIZE)
+            return ::std::nullopt;
+        const uint32_t count = read_u32(data);
+        if ((length - HEADER_SIZE) / HEADER_SIZE < count)
+            return ::std::nullopt;
+        size_t offset = HEADER_SIZE + HEADER_SIZE * static_cast<size_t>(count);
+        ::std::vector<::std::string> &words = response.words;
+        words.reserve(count);
+        for (uint32_t i = 0; i < count; ++i) {
+            const uint32_t word_length = read_u32(data + HEADER_SIZE * (i + 1));
+            if (length - offset < word_length)
+                return ::std::nullopt;
+            words.emplace_back(data + offset, word_length);
+            offset += word_length;
+        }
+        if (offset != length)
+            return ::std::nullopt;
+        return response;
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include "LatencyHistogram.h"
+#include "Segmenter.h"
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+struct ServerOptions
+{
+    ::std::string unix_path;                 // 非空时监听该Unix域套接字
+    uint16_t tcp_port = 0;                   // 否则监听127.0.0.1上的该端口
+    size_t workers = 0;                      // 工作线程数，0表示使用硬件线程数
+    size_t max_batch_requests = 64;          // 每批最多请求数
+    size_t max_batch_bytes = 64 * 1024;      // 每批最多负载字节数
+    size_t small_request_bytes = 4 * 1024;   // 超过该大小的请求单独成批
+    size_t max_pending_requests = 1024;      // 每个连接最多在途的请求数
+    size_t max_pending_bytes = 4 << 20;      // 每个连接在途请求的负载字节数上限（最多超出一帧）
+    size_t max_output_bytes = 1 << 20;       // 每个连接最多积压的未发送响应字节数
+};
+
+
+// 本地分词服务
+// 单个epoll事件循环负责接入、读写和按连接的流水线解析，同一轮事件中读到的小请求
+// 合并成批交给工作线程，工作线程完成后经eventfd唤醒事件循环，响应按请求顺序写回。
+// 某个连接的在途请求数、在途请求字节数或积压的响应字节数达到上限时暂停读取该连接（反压），
+// 响应写出后再恢复，因此慢客户端不会让任务队列和发送缓冲区无限增长。
+// 事件循环依赖Linux的epoll/eventfd，其它平台上run()会抛出异常。
+class SegServer {
+public:
+    SegServer(Segmenter segmenter, ServerOptions options);
+    ~SegServer();
+
+    // 删除拷贝构造函数和赋值运算符
+    SegServer(const SegServer&) = delete;
+    SegServer &operator=(const SegServer&) = delete;
+
+    // 创建、绑定并监听套接字，返回后客户端即可连接
+    void listen();
+
+    // 运行事件循环，直到stop()被调用；尚未监听时先调用listen()
+    void run();
+
+    // 请求停止，可在信号处理函数中调用
+    void stop();
+
+    // 从收到完整请求到响应写入发送缓冲区的延迟
+    LatencyHistogram latency() const;
+
+private:
+    struct Impl;
+    ::std::unique_ptr<Impl> impl_;
+};
@@ -0,0 +1,96 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <optional>
+#include <mutex>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+
+
+// 句子级分词结果缓存
+// 以输入字节的快速哈希为键，按分片加锁支持并发访问，每个分片维护自己的LRU链表，
+// 所有分片共享一个总字节预算：超出预算时先淘汰本分片最旧的条目，仍不够再轮流淘汰
+// 其它分片的最旧条目（并发写入时可能短暂超出预算）。分词结果只保存每个词的字节长度（变长编码），
+// 取出时再从原句中切分还原，因此每条缓存只比原句多出几十字节。
+class SegmentCache {
+public:
+    struct Stats {
+        uint64_t hits = 0;          // 命中次数
+        uint64_t misses = 0;        // 未命中次数（包括因字典变化而失效的条目）
+        uint64_t invalidations = 0; // 因字典代际不一致而丢弃的条目数
+        uint64_t evictions = 0;     // 因超出字节预算而淘汰的条目数
+        size_t entries = 0;         // 当前条目数
+        size_t bytes = 0;           // 当前占用字节数（估算）
+        size_t byte_budget = 0;     // 字节预算
+
+        double hit_rate() const {
+            const uint64_t total = hits + misses;
+            return total == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(total);
+        }
+    };
+
+    explicit SegmentCache(size_t byte_budget, size_t shard_count = 16);
+
+    // 删除拷贝构造函数和赋值运算符，分片内含互斥锁
+    SegmentCache(const SegmentCache&) = delete;
+    SegmentCache &operator=(const SegmentCache&) = delete;
+
+    // 查找句子的分词结果，generation为当前字典的代际编号，不一致的条目视为失效
+    ::std::optional<::std::vector<::std::string>> get(
+        const ::std::string &sentence,
+        uint64_t generation
+    );
+
+    // 写入句子的分词结果，若各词拼接后与原句不一致（例如含非法UTF-8）则不缓存
+    void put(
+        const ::std::string &sentence,
+        const ::std::vector<::std::string> &words,
+        uint64_t generation
+    );
+
+    void clear(void);
+
+    Stats stats() const;
+
+    void info() const;
+
+    // 每次处理8字节的快速哈希函数
+    static uint64_t hash_bytes(const char *data, size_t length);
+
+private:
+    struct Entry {
+        uint64_t hash;
+        uint64_t generation;
+        ::std::string sentence;
+        ::std::string spans;    // 各词字节长度的LEB128变长编码
+
+        size_t bytes() const;
+    };
+
+    struct Shard {
+        ::std::mutex mutex;
+        ::std::list<Entry> lru;  // 表头为最近使用
+        ::std::unordered_map<uint64_t, ::std::list<Entry>::iterator> index;
+        size_t bytes = 0;
+    };
+
+    Shard &shard_for(uint64_t hash) const;
+    void remove(Shard &shard, ::std::list<Entry>::iterator it);
+
+    // 从除skip以外的分片轮流淘汰最旧条目，直到总占用不超过预算
+    void evict_others(const Shard &skip);
+
+    size_t byte_budget_;
+    size_t shard_count_;
+    ::std::unique_ptr<Shard[]> shards_;
+    ::std::atomic<size_t> total_bytes_{0};
+    ::std::atomic<size_t> evict_cursor_{0};   // 跨分片淘汰的起始分片
+
+    ::std::atomic<uint64_t> hits_{0};
+    ::std::atomic<uint64_t> misses_{0};
+    ::std::atomic<uint64_t> invalidations_{0};
+    ::std::atomic<uint64_t> evictions_{0};
+};
@@ -0,0 +1,8 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <functional>
+
+
+// 分词回调，输入UTF-8句子，返回分词结果，会被多个工作线程并发调用
+using Segmenter = ::std::function<::std::vector<::std::string>(const ::std::string &)>;
@@ -0,0 +1,293 @@
+#include "CompactDict.h"
+#include "MultiHashTable.h"
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+
+namespace
+{
+    void append_varint(::std::string &out, size_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    size_t read_varint(const char *&p) {
+        size_t value = 0;
+        int shift = 0;
+        for (;;) {
+            const auto byte = static_cast<unsigned char>(*p++);
+            value |= static_cast<size_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                return value;
+            shift += 7;
+        }
+    }
+
+    size_t common_prefix(::std::string_view a, ::std::string_view b) {
+        const size_t limit = ::std::min(a.size(), b.size());
+        size_t i = 0;
+        while (i < limit && a[i] == b[i])
+            ++i;
+        return i;
+    }
+}
+
+
+CompactDict::CompactDict() : generation_(next_dictionary_generation()) {}
+
+
+CompactDict::CompactDict(
+    ::std::vector<::std::pair<::std::string, ::std::string>> entries,
+    bool keep_values
+) : generation_(next_dictionary_generation()) {
+    ::std::stable_sort(entries.begin(), entries.end(),
+        [](const auto &a, const auto &b) { return a.first < b.first; });
+
+    // 重复的键只保留最后一次出现的值，与MultiHashTable::insert的覆盖语义一致
+    size_t unique = 0;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (i + 1 < entries.size() && entries[i + 1].first == entries[i].first)
+            continue;
+        if (unique != i)
+            entries[unique] = ::std::move(entries[i]);
+        ++unique;
+    }
+    entries.resize(unique);
+    if (entries.size() > ::std::numeric_limits<uint32_t>::max())
+        throw ::std::invalid_argument("Too many entries for 32-bit ids");
+    size_ = static_cast<uint32_t>(entries.size());
+
+    buckets_.reserve((entries.size() + BUCKET_SIZE - 1) / BUCKET_SIZE);
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const ::std::string &key = entries[i].first;
+        if (i % BUCKET_SIZE == 0) {
+            buckets_.push_back(static_cast<uint32_t>(blob_.size()));
+            append_varint(blob_, key.size());
+            blob_ += key;
+        } else {
+            const size_t shared = common_prefix(entries[i - 1].first, key);
+            append_varint(blob_, shared);
+            append_varint(blob_, key.size() - shared);
+            blob_.append(key, shared, ::std::string::npos);
+        }
+    }
+
+    if (keep_values) {
+        values_.reserve(entries.size() + 1);
+        for (const auto &entry : entries) {
+            values_.push_back(static_cast<uint32_t>(blob_.size()));
+            blob_ += entry.second;
+        }
+        values_.push_back(static_cast<uint32_t>(blob_.size()));
+    }
+    if (blob_.size() > ::std::numeric_limits<uint32_t>::max())
+        throw ::std::invalid_argument("Dictionary too large for 32-bit offsets");
+
+    blob_.shrink_to_fit();
+}
+
+
+::std::string_view CompactDict::bucket_head(size_t bucket) const {
+    const char *p = blob_.data() + buckets_[bucket];
+    const size_t length = read_varint(p);
+    return ::std::string_view(p, length);
+}
+
+
+size_t CompactDict::locate_bucket(::std::string_view key) const {
+    // 二分查找首个首键大于key的桶，其前一个桶即为候选
+    size_t low = 0;
+    size_t high = buckets_.size();
+    while (low < high) {
+        const size_t mid = low + (high - low) / 2;
+        if (bucket_head(mid) <= key)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low == 0 ? buckets_.size() : low - 1;
+}
+
+
+::std::optional<uint32_t> CompactDict::find(::std::string_view key) const {
+    const size_t bucket = locate_bucket(key);
+    if (bucket == buckets_.size())
+        return ::std::nullopt;
+
+    const char *p = blob_.data() + buckets_[bucket];
+    const size_t head_length = read_varint(p);
+    const ::std::string_view head(p, head_length);
+    p += head_length;
+
+    uint32_t id = static_cast<uint32_t>(bucket * BUCKET_SIZE);
+    size_t matched = common_prefix(head, key);
+    if (matched == key.size() && head.size() == key.size())
+        return id;
+
+    // 此后当前键始终小于key，matched为当前键与key的公共前缀长度，
+    // 只需比较前缀编码的共享长度即可判断下一个键与key的大小关系，无需还原完整的键
+    const uint32_t end = static_cast<uint32_t>(::std::min<size_t>(size_, (bucket + 1) * BUCKET_SIZE));
+    for (++id; id < end; ++id) {
+        const size_t shared = read_varint(p);
+        const size_t suffix_length = read_varint(p);
+        const ::std::string_view suffix(p, suffix_length);
+        p += suffix_length;
+
+        if (shared > matched)
+            continue;
+        if (shared < matched)
+            return ::std::nullopt;
+
+        const size_t extra = common_prefix(suffix, key.substr(matched));
+        matched += extra;
+        if (extra == suffix_length) {
+            if (matched == key.size())
+                return id;
+            continue;
+        }
+        if (matched == key.size()
+            || static_cast<unsigned char>(suffix[extra]) > static_cast<unsigned char>(key[matched]))
+            return ::std::nullopt;
+    }
+    return ::std::nullopt;
+}
+
+
+::std::optional<::std::string_view> CompactDict::get(::std::string_view key) const {
+    if (values_.empty())
+        return ::std::nullopt;
+    const ::std::optional<uint32_t> id = find(key);
+    if (!id.has_value())
+        return ::std::nullopt;
+    return value_at(id.value());
+}
+
+
+const char *CompactDict::decode_next(const char *p, uint32_t id, ::std::string &key) const {
+    // 各桶在blob_中首尾相接，桶首键完整保存，其余键在前一个键的基础上还原
+    if (id % BUCKET_SIZE == 0) {
+        const size_t length = read_varint(p);
+        key.assign(p, length);
+        return p + length;
+    }
+    const size_t shared = read_varint(p);
+    const size_t suffix_length = read_varint(p);
+    key.resize(shared);
+    key.append(p, suffix_length);
+    return p + suffix_length;
+}
+
+
+const char *CompactDict::seek(uint32_t id, ::std::string &key) const {
+    const uint32_t first = static_cast<uint32_t>(id / BUCKET_SIZE * BUCKET_SIZE);
+    const char *p = blob_.data() + buckets_[id / BUCKET_SIZE];
+    for (uint32_t i = first; i <= id; ++i)
+        p = decode_next(p, i, key);
+    return p;
+}
+
+
+uint32_t CompactDict::lower_bound(::std::string_view key) const {
+    const size_t bucket = locate_bucket(key);
+    if (bucket == buckets_.size())
+        return 0;
+    ::std::string current;
+    const char *p = blob_.data() + buckets_[bucket];
+    const uint32_t first = static_cast<uint32_t>(bucket * BUCKET_SIZE);
+    const uint32_t end = static_cast<uint32_t>(::std::min<size_t>(size_, first + BUCKET_SIZE));
+    for (uint32_t id = first; id < end; ++id) {
+        p = decode_next(p, id, current);
+        if (::std::string_view(current) >= key)
+            return id;
+    }
+    // 下一个桶的首键一定大于key
+    return end;
+}
+
+
+::std::string CompactDict::key_at(uint32_t id) const {
+    if (id >= size_)
+        throw ::std::invalid_argument("Index out of range");
+    ::std::string key;
+    seek(id, key);
+    return key;
+}
+
+
+::std::string_view CompactDict::value_at(uint32_t id) const {
+    if (id >= size_)
+        throw ::std::invalid_argument("Index out of range");
+    if (values_.empty())
+        return ::std::string_view();
+    return ::std::string_view(blob_.data() + values_[id], values_[id + 1] - values_[id]);
+}
+
+
+CompactDict::PrefixRange CompactDict::prefix_range(::std::string_view prefix, size_t limit) const {
+    PrefixRange range;
+    range.dict_ = this;
+    range.prefix_ = ::std::string(prefix);
+    range.first_ = lower_bound(prefix);
+    range.limit_ = limit;
+    return range;
+}
+
+
+CompactDict::PrefixIterator CompactDict::PrefixRange::begin() const {
+    PrefixIterator it;
+    if (limit_ == 0 || first_ >= dict_->size_)
+        return it;
+    it.dict_ = dict_;
+    it.prefix_ = prefix_;
+    it.remaining_ = limit_;
+    it.next_ = dict_->seek(first_, it.key_);
+    it.id_ = first_;
+    it.done_ = false;
+    it.settle();
+    return it;
+}
+
+
+void CompactDict::PrefixIterator::settle() {
+    // 键按字典序排列，第一个不以prefix开头的键之后不会再有匹配
+    if (key_.compare(0, prefix_.size(), prefix_) != 0)
+        done_ = true;
+}
+
+
+CompactDict::PrefixIterator &CompactDict::PrefixIterator::operator++() {
+    const uint32_t id = id_ + 1;
+    if (--remaining_ == 0 || id >= dict_->size_) {
+        done_ = true;
+        return *this;
+    }
+    next_ = dict_->decode_next(next_, id, key_);
+    id_ = id;
+    settle();
+    return *this;
+}
+
+
+size_t CompactDict::memory_usage() const {
+    return sizeof(*this)
+        + blob_.capacity()
+        + buckets_.capacity() * sizeof(uint32_t)
+        + values_.capacity() * sizeof(uint32_t);
+}
+
+
+void CompactDict::info() const {
+    const size_t key_bytes = values_.empty() ? blob_.size() : values_.front();
+    ::std::cout
+        << "CompactDict Info:\n"
+        << "Entries: " << size_
+        << ", Buckets: " << buckets_.size() << "\n"
+        << "Key Bytes: " << key_bytes
+        << ", Value Bytes: " << (blob_.size() - key_bytes) << "\n"
+        << "Total Memory: " << memory_usage() << " bytes\n\n";
+}
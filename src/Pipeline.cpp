@@ -0,0 +1,358 @@
+#include "Pipeline.h"
+#include "PreSplit.h"
+#include "BoundedQueue.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+
+namespace
+{
+    using Clock = ::std::chrono::steady_clock;
+
+    // 读取阶段输出的一块原始行
+    struct LineChunk
+    {
+        uint64_t seq = 0;
+        ::std::vector<::std::string> lines;
+        bool last = false;
+    };
+
+    // 分词阶段输出的一块已格式化文本
+    struct TextChunk
+    {
+        uint64_t seq = 0;
+        ::std::string text;
+        bool last = false;
+    };
+
+    // 等待策略：先空转，再让出时间片，长时间等待时短暂休眠以免空耗CPU
+    void backoff(unsigned &spins) {
+        if (spins >= 256)
+            ::std::this_thread::sleep_for(::std::chrono::microseconds(20));
+        else if (spins >= 64)
+            ::std::this_thread::yield();
+        ++spins;
+    }
+
+    // 阻塞式入队，返回false表示流水线已中止
+    template <typename Queue, typename T>
+    bool push_wait(Queue &queue, T &item, Clock::duration &blocked, const ::std::atomic<bool> &aborted) {
+        if (queue.try_push(item))
+            return true;
+        const auto start = Clock::now();
+        unsigned spins = 0;
+        while (!queue.try_push(item)) {
+            if (aborted.load(::std::memory_order_relaxed))
+                return false;
+            backoff(spins);
+        }
+        blocked += Clock::now() - start;
+        return true;
+    }
+
+    // 阻塞式出队，返回false表示流水线已中止
+    template <typename Queue, typename T>
+    bool pop_wait(Queue &queue, T &item, Clock::duration &starved, const ::std::atomic<bool> &aborted) {
+        if (queue.try_pop(item))
+            return true;
+        const auto start = Clock::now();
+        unsigned spins = 0;
+        while (!queue.try_pop(item)) {
+            if (aborted.load(::std::memory_order_relaxed))
+                return false;
+            backoff(spins);
+        }
+        starved += Clock::now() - start;
+        return true;
+    }
+
+    // 单线程的阶段计时，总时长减去等待时长即为工作时长
+    struct StageTimer
+    {
+        Clock::time_point start = Clock::now();
+        Clock::duration starved{0};
+        Clock::duration blocked{0};
+        uint64_t items = 0;
+
+        void finish(StageStats &stats) const {
+            const auto to_ms = [](Clock::duration d) {
+                return ::std::chrono::duration<double, ::std::milli>(d).count();
+            };
+            const Clock::duration total = Clock::now() - start;
+            stats.items += items;
+            stats.busy_ms += to_ms(total - starved - blocked);
+            stats.starved_ms += to_ms(starved);
+            stats.blocked_ms += to_ms(blocked);
+        }
+    };
+}
+
+
+PipelineReport run_pipeline(
+    ::std::istream &in,
+    ::std::ostream &out,
+    const Segmenter &segmenter,
+    const PipelineOptions &options
+) {
+    size_t workers = options.workers;
+    if (workers == 0) {
+        const size_t hardware = ::std::thread::hardware_concurrency();
+        workers = hardware > 4 ? hardware - 3 : 1;
+    }
+
+    SpscQueue<LineChunk> raw_queue(options.queue_capacity);       // 读取 -> 校验
+    MpmcQueue<LineChunk> line_queue(options.queue_capacity);      // 校验 -> 分词
+    MpmcQueue<TextChunk> text_queue(options.queue_capacity);      // 分词 -> 写出
+
+    ::std::atomic<bool> aborted{false};
+    ::std::mutex error_mutex;
+    ::std::exception_ptr error;
+    const auto guarded = [&](auto &&stage) {
+        return [&, stage]() mutable {
+            try {
+                stage();
+            } catch (...) {
+                ::std::lock_guard<::std::mutex> lock(error_mutex);
+                if (!error)
+                    error = ::std::current_exception();
+                aborted.store(true);
+            }
+        };
+    };
+
+    PipelineReport report;
+    report.stages.resize(4);
+    StageStats &reader_stats = report.stages[0];
+    StageStats &decoder_stats = report.stages[1];
+    StageStats &segmenter_stats = report.stages[2];
+    StageStats &writer_stats = report.stages[3];
+    reader_stats.name = "Reader";
+    decoder_stats.name = "Decoder";
+    segmenter_stats.name = "Segmenter";
+    segmenter_stats.threads = workers;
+    writer_stats.name = "Writer";
+    ::std::mutex segmenter_stats_mutex;
+
+    // 写出阶段已写出的块数。分词线程只处理序号落在[written, written + window)内的块，
+    // 因此写出阶段等待重排的块不超过window个。块按序号顺序出队，持有序号written的线程
+    // 总能继续执行，不会死锁。
+    const uint64_t window = ::std::max<size_t>(options.queue_capacity, 1);
+    ::std::atomic<uint64_t> written{0};
+
+    // 读取阶段：按块读取输入并切分成行，跳过空行
+    auto reader = [&]() {
+        StageTimer timer;
+        ::std::vector<char> block(::std::max<size_t>(options.read_block, 1));
+        ::std::string partial;
+        LineChunk chunk;
+        size_t chunk_bytes = 0;
+        uint64_t seq = 0;
+
+        const auto emit = [&](bool last) {
+            chunk.seq = seq++;
+            chunk.last = last;
+            // 结束标记不含行，不计入块数，与其它阶段一致
+            if (!chunk.lines.empty())
+                ++timer.items;
+            const bool pushed = push_wait(raw_queue, chunk, timer.blocked, aborted);
+            chunk = LineChunk();
+            chunk_bytes = 0;
+            return pushed;
+        };
+        const auto add_line = [&](::std::string &&line) {
+            if (line.empty())
+                return true;
+            chunk_bytes += line.size();
+            chunk.lines.push_back(::std::move(line));
+            if (chunk.lines.size() >= options.chunk_lines || chunk_bytes >= options.chunk_bytes)
+                return emit(false);
+            return true;
+        };
+
+        for (;;) {
+            in.read(block.data(), static_cast<::std::streamsize>(block.size()));
+            const size_t count = static_cast<size_t>(in.gcount());
+            if (in.bad())
+                throw ::std::runtime_error("Failed to read input");
+            size_t begin = 0;
+            while (begin < count) {
+                const void *found = ::std::memchr(block.data() + begin, '\n', count - begin);
+                if (found == nullptr) {
+                    partial.append(block.data() + begin, count - begin);
+                    break;
+                }
+                const size_t end = static_cast<size_t>(static_cast<const char *>(found) - block.data());
+                partial.append(block.data() + begin, end - begin);
+                if (!add_line(::std::move(partial)))
+                    return;
+                partial.clear();
+                begin = end + 1;
+            }
+            if (count < block.size())
+                break;
+        }
+        if (!add_line(::std::move(partial)))
+            return;
+        if (!chunk.lines.empty() && !emit(false))
+            return;
+        emit(true);
+        timer.finish(reader_stats);
+    };
+
+    // 校验阶段：替换非法UTF-8序列，保证分词和输出都是合法文本
+    auto decoder = [&]() {
+        StageTimer timer;
+        LineChunk chunk;
+        for (;;) {
+            if (!pop_wait(raw_queue, chunk, timer.starved, aborted))
+                return;
+            if (chunk.last)
+                break;
+            ++timer.items;
+            for (auto &line : chunk.lines) {
+                ++report.lines;
+                if (sanitize_utf8(line) != 0)
+                    ++report.invalid_lines;
+            }
+            if (!push_wait(line_queue, chunk, timer.blocked, aborted))
+                return;
+        }
+        // 每个分词线程各收到一个结束标记
+        for (size_t i = 0; i < workers; ++i) {
+            LineChunk last;
+            last.last = true;
+            if (!push_wait(line_queue, last, timer.blocked, aborted))
+                return;
+        }
+        timer.finish(decoder_stats);
+    };
+
+    // 分词阶段：逐行分词并格式化为输出文本
+    auto worker = [&]() {
+        StageTimer timer;
+        LineChunk chunk;
+        TextChunk text;
+        for (;;) {
+            if (!pop_wait(line_queue, chunk, timer.starved, aborted))
+                return;
+            if (chunk.last)
+                break;
+            ++timer.items;
+            if (chunk.seq - written.load(::std::memory_order_acquire) >= window) {
+                const auto start = Clock::now();
+                unsigned spins = 0;
+                while (chunk.seq - written.load(::std::memory_order_acquire) >= window) {
+                    if (aborted.load(::std::memory_order_relaxed))
+                        return;
+                    backoff(spins);
+                }
+                timer.blocked += Clock::now() - start;
+            }
+            text = TextChunk();
+            text.seq = chunk.seq;
+            for (const auto &line : chunk.lines) {
+                for (const auto &word : segmenter(line)) {
+                    text.text += word;
+                    text.text += ' ';
+                }
+                text.text += '\n';
+            }
+            if (!push_wait(text_queue, text, timer.blocked, aborted))
+                return;
+        }
+        text = TextChunk();
+        text.last = true;
+        if (!push_wait(text_queue, text, timer.blocked, aborted))
+            return;
+        ::std::lock_guard<::std::mutex> lock(segmenter_stats_mutex);
+        timer.finish(segmenter_stats);
+    };
+
+    // 写出阶段：按块序号恢复原始顺序后写出
+    auto writer = [&]() {
+        StageTimer timer;
+        ::std::map<uint64_t, ::std::string> pending;
+        uint64_t next_seq = 0;
+        size_t finished_workers = 0;
+        TextChunk text;
+        while (finished_workers < workers) {
+            if (!pop_wait(text_queue, text, timer.starved, aborted))
+                return;
+            if (text.last) {
+                ++finished_workers;
+                continue;
+            }
+            ++timer.items;
+            pending.emplace(text.seq, ::std::move(text.text));
+            while (!pending.empty() && pending.begin()->first == next_seq) {
+                const ::std::string &block = pending.begin()->second;
+                out.write(block.data(), static_cast<::std::streamsize>(block.size()));
+                pending.erase(pending.begin());
+                ++next_seq;
+            }
+            written.store(next_seq, ::std::memory_order_release);
+        }
+        out.flush();
+        timer.finish(writer_stats);
+    };
+
+    const auto start_time = Clock::now();
+    ::std::vector<::std::thread> threads;
+    threads.emplace_back(guarded(reader));
+    threads.emplace_back(guarded(decoder));
+    for (size_t i = 0; i < workers; ++i)
+        threads.emplace_back(guarded(worker));
+    threads.emplace_back(guarded(writer));
+    for (auto &thread : threads)
+        thread.join();
+    report.wall_ms = ::std::chrono::duration<double, ::std::milli>(Clock::now() - start_time).count();
+
+    if (error)
+        ::std::rethrow_exception(error);
+    return report;
+}
+
+
+void PipelineReport::info() const {
+    // 多线程阶段按线程数折算为等效耗时
+    const auto stage_ms = [](const StageStats &stage) {
+        return stage.busy_ms / static_cast<double>(stage.threads);
+    };
+    double sum_ms = 0;
+    const StageStats *bottleneck = nullptr;
+    for (const auto &stage : stages) {
+        sum_ms += stage_ms(stage);
+        if (bottleneck == nullptr || stage_ms(stage) > stage_ms(*bottleneck))
+            bottleneck = &stage;
+    }
+
+    ::std::cout << "Pipeline Info:\n" << ::std::fixed << ::std::setprecision(2);
+    for (const auto &stage : stages) {
+        const double utilization = wall_ms > 0 ? stage_ms(stage) * 100.0 / wall_ms : 0.0;
+        ::std::cout
+            << ::std::left << ::std::setw(10) << stage.name << ::std::right
+            << "Threads=" << stage.threads
+            << ", Items=" << stage.items
+            << ", Busy=" << stage.busy_ms << " ms"
+            << ", Starved=" << stage.starved_ms << " ms"
+            << ", Blocked=" << stage.blocked_ms << " ms"
+            << ", Utilization=" << utilization << "%\n";
+    }
+    if (bottleneck != nullptr)
+        ::std::cout << "Bottleneck: " << bottleneck->name << "\n";
+    ::std::cout
+        << "Wall=" << wall_ms << " ms"
+        << ", Max stage=" << (bottleneck != nullptr ? stage_ms(*bottleneck) : 0.0) << " ms"
+        << ", Sum of stages=" << sum_ms << " ms\n"
+        << "Lines: " << lines << ", Invalid UTF-8 lines: " << invalid_lines << "\n\n"
+        << ::std::defaultfloat << ::std::setprecision(6);
+}
@@ -1,12 +1,81 @@
 #include "MultiHashTable.h"
-#include <windows.h>
+#include "SegmentCache.h"
+#include "CompactDict.h"
 #include <string>
 #include <codecvt>
 #include <locale>
 #include <vector>
 #include <optional>
+#include <stdexcept>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+
+namespace
+{
+    constexpr const char *REPLACEMENT_CHARACTER = "\xEF\xBF\xBD";   // U+FFFD
+
+    // 返回从p开始的合法UTF-8序列长度，非法时返回0（拒绝超长编码、代理区和超出U+10FFFF的码点）
+    size_t valid_sequence(const unsigned char *p, size_t remaining) {
+        const unsigned char c = p[0];
+        if (c < 0x80)
+            return 1;
+        if (c < 0xC2)
+            return 0;
+        if (c < 0xE0)
+            return (remaining >= 2 && (p[1] & 0xC0) == 0x80) ? 2 : 0;
+        if (c < 0xF0) {
+            if (remaining < 3 || (p[1] & 0xC0) != 0x80 || (p[2] & 0xC0) != 0x80)
+                return 0;
+            if ((c == 0xE0 && p[1] < 0xA0) || (c == 0xED && p[1] >= 0xA0))
+                return 0;
+            return 3;
+        }
+        if (c < 0xF5) {
+            if (remaining < 4 || (p[1] & 0xC0) != 0x80 || (p[2] & 0xC0) != 0x80 || (p[3] & 0xC0) != 0x80)
+                return 0;
+            if ((c == 0xF0 && p[1] < 0x90) || (c == 0xF4 && p[1] >= 0x90))
+                return 0;
+            return 4;
+        }
+        return 0;
+    }
+}
 
 
+size_t sanitize_utf8(::std::string &text) {
+    const auto *data = reinterpret_cast<const unsigned char *>(text.data());
+    const size_t size = text.size();
+    size_t replaced = 0;
+    size_t copied = 0;  // text[0, copied)已处理并写入result
+    ::std::string result;
+    size_t i = 0;
+    while (i < size) {
+        const size_t length = valid_sequence(data + i, size - i);
+        if (length != 0) {
+            i += length;
+            continue;
+        }
+        // 只有遇到非法字节时才重建字符串
+        if (replaced == 0)
+            result.reserve(size + 8);
+        result.append(text, copied, i - copied);
+        result += REPLACEMENT_CHARACTER;
+        ++replaced;
+        ++i;
+        copied = i;
+    }
+    if (replaced != 0) {
+        result.append(text, copied, ::std::string::npos);
+        text.swap(result);
+    }
+    return replaced;
+}
+
+
+#ifdef _WIN32
+
 ::std::wstring utf8_to_unicode(const ::std::string& utf8_str) {
     if (utf8_str.empty()) return L"";
 
@@ -53,6 +122,32 @@
     return utf8_str;
 }
 
+#else
+
+// 非Windows平台使用标准库完成编码转换
+// wstring_convert遇到任何非法字节都会让整句转换失败，此时把非法序列替换为U+FFFD后重试，
+// 与MultiByteToWideChar的默认行为一致，只有坏掉的字节受影响。合法输入（例如已经过
+// 流水线校验阶段的行）只转换一次，不做额外的扫描和拷贝
+::std::wstring utf8_to_unicode(const ::std::string& utf8_str) {
+    if (utf8_str.empty()) return L"";
+    ::std::wstring_convert<::std::codecvt_utf8<wchar_t>> converter;
+    try {
+        return converter.from_bytes(utf8_str);
+    } catch (const ::std::range_error &) {
+        ::std::string sanitized = utf8_str;
+        sanitize_utf8(sanitized);
+        return converter.from_bytes(sanitized);
+    }
+}
+
+::std::string unicode_to_utf8(const ::std::wstring& wstr) {
+    if (wstr.empty()) return "";
+    ::std::wstring_convert<::std::codecvt_utf8<wchar_t>> converter("", L"");
+    return converter.to_bytes(wstr);
+}
+
+#endif
+
 struct MatchInfo
 {
     ::std::wstring longest_match = L"";   // 最长匹配子串
@@ -64,60 +159,140 @@ struct MatchInfo
 constexpr int MAX_CONSECUTIVE_MISSES = 4; // 最大允许连续未命中次数
 
 
+namespace
+{
+    bool dict_contains(const MultiHashTable<::std::string, ::std::string>& table, const ::std::string& key) {
+        return table.get(key).has_value();
+    }
+
+    bool dict_contains(const CompactDict& dict, const ::std::string& key) {
+        return dict.contains(key);
+    }
+
+
+    template <typename Dict>
+    MatchInfo find_max_match_impl(
+        const Dict& table,
+        const ::std::wstring& sentence,
+        size_t start_pos
+    ) {
+        MatchInfo result;
+        int consecutive_misses = 0;
+        size_t max_length = 0;
+        const size_t max_pos = sentence.size();
+        for (size_t end_pos = start_pos + 1; end_pos <= max_pos; ++end_pos) {
+            const size_t length = end_pos - start_pos;
+            const ::std::wstring current_substr = sentence.substr(start_pos, length);
+            const ::std::string utf8_str = unicode_to_utf8(current_substr);
+            if (dict_contains(table, utf8_str)) {
+                ++result.match_count;
+                if (result.first_match_end_pos == -1) {
+                    result.first_match_end_pos = static_cast<int>(end_pos - 1);
+                }
+                if (length > max_length) {
+                    max_length = length;
+                    result.longest_match = current_substr;
+                    result.longest_end_pos = static_cast<int>(end_pos - 1);
+                }
+                consecutive_misses = 0;
+            } else {
+                if (++consecutive_misses >= MAX_CONSECUTIVE_MISSES) {
+                    break;
+                }
+            }
+        }
+        return result;
+    }
+
+    // 完整的分词函数
+    template <typename Dict>
+    ::std::vector<::std::string> split_impl(
+        const Dict& table,
+        const ::std::string& sentence
+    ) {
+        const ::std::wstring w_sentence = utf8_to_unicode(sentence);
+        ::std::vector<::std::string> result;
+        size_t start_pos = 0;
+        while (start_pos < w_sentence.size()) {
+            MatchInfo match = find_max_match_impl(table, w_sentence, start_pos);
+
+            if (match.longest_end_pos != -1) {
+                const size_t length = match.longest_end_pos - start_pos + 1;
+                result.push_back(unicode_to_utf8(
+                    w_sentence.substr(start_pos, length)));
+                start_pos = match.longest_end_pos + 1;
+            } else {
+                result.push_back(unicode_to_utf8(
+                    w_sentence.substr(start_pos, 1)));
+                ++start_pos;
+            }
+        }
+        return result;
+    }
+
+    // 带缓存的分词函数，命中则直接返回缓存结果，否则分词后写入缓存
+    template <typename Dict>
+    ::std::vector<::std::string> cached_split_impl(
+        const Dict& table,
+        const ::std::string& sentence,
+        SegmentCache& cache
+    ) {
+        const uint64_t generation = table.generation();
+        ::std::optional<::std::vector<::std::string>> cached = cache.get(sentence, generation);
+        if (cached.has_value())
+            return ::std::move(cached.value());
+
+        ::std::vector<::std::string> result = split_impl(table, sentence);
+        cache.put(sentence, result, generation);
+        return result;
+    }
+}
+
+
 MatchInfo find_max_match(
     const MultiHashTable<::std::string, ::std::string>& table,
     const ::std::wstring& sentence,
     size_t start_pos
 ) {
-    MatchInfo result;
-    int consecutive_misses = 0;
-    size_t max_length = 0;
-    const size_t max_pos = sentence.size();
-    for (size_t end_pos = start_pos + 1; end_pos <= max_pos; ++end_pos) {
-        const size_t length = end_pos - start_pos;
-        const ::std::wstring current_substr = sentence.substr(start_pos, length);
-        const ::std::string utf8_str = unicode_to_utf8(current_substr);
-        if (table.get(utf8_str)) {
-            ++result.match_count;
-            if (result.first_match_end_pos == -1) {
-                result.first_match_end_pos = static_cast<int>(end_pos - 1);
-            }
-            if (length > max_length) {
-                max_length = length;
-                result.longest_match = current_substr;
-                result.longest_end_pos = static_cast<int>(end_pos - 1);
-            }
-            consecutive_misses = 0;
-        } else {
-            if (++consecutive_misses >= MAX_CONSECUTIVE_MISSES) {
-                break;
-            }
-        }
-    }
-    return result;
+    return find_max_match_impl(table, sentence, start_pos);
+}
+
+MatchInfo find_max_match(
+    const CompactDict& dict,
+    const ::std::wstring& sentence,
+    size_t start_pos
+) {
+    return find_max_match_impl(dict, sentence, start_pos);
 }
 
-// 完整的分词函数
+
 ::std::vector<::std::string> MaxiumSplit(
     const MultiHashTable<::std::string, ::std::string>& table,
     const ::std::string& sentence
 ) {
-    const ::std::wstring w_sentence = utf8_to_unicode(sentence);
-    ::std::vector<::std::string> result;
-    size_t start_pos = 0;
-    while (start_pos < w_sentence.size()) {
-        MatchInfo match = find_max_match(table, w_sentence, start_pos);
-        
-        if (match.longest_end_pos != -1) {
-            const size_t length = match.longest_end_pos - start_pos + 1;
-            result.push_back(unicode_to_utf8(
-                w_sentence.substr(start_pos, length)));
-            start_pos = match.longest_end_pos + 1;
-        } else {
-            result.push_back(unicode_to_utf8(
-                w_sentence.substr(start_pos, 1)));
-            ++start_pos;
-        }
-    }
-    return result;
+    return split_impl(table, sentence);
+}
+
+::std::vector<::std::string> MaxiumSplit(
+    const CompactDict& dict,
+    const ::std::string& sentence
+) {
+    return split_impl(dict, sentence);
+}
+
+
+::std::vector<::std::string> MaxiumSplit(
+    const MultiHashTable<::std::string, ::std::string>& table,
+    const ::std::string& sentence,
+    SegmentCache& cache
+) {
+    return cached_split_impl(table, sentence, cache);
+}
+
+::std::vector<::std::string> MaxiumSplit(
+    const CompactDict& dict,
+    const ::std::string& sentence,
+    SegmentCache& cache
+) {
+    return cached_split_impl(dict, sentence, cache);
 }
\ No newline at end of file
@@ -0,0 +1,612 @@
+#include "SegServer.h"
+#include "SegProtocol.h"
+#include "PreSplit.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#ifdef __linux__
+#include <condition_variable>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+
+#ifdef __linux__
+
+namespace
+{
+    using Clock = ::std::chrono::steady_clock;
+
+    constexpr uint64_t LISTEN_ID = 0;   // epoll中监听套接字的标识
+    constexpr uint64_t WAKE_ID = 1;     // epoll中eventfd的标识
+    constexpr int MAX_EVENTS = 256;
+    constexpr int POLL_TIMEOUT_MS = 200;
+    constexpr size_t READ_CHUNK = 64 * 1024;
+
+    [[noreturn]] void throw_errno(const char *what) {
+        throw ::std::runtime_error(::std::string(what) + ": " + ::std::strerror(errno));
+    }
+
+    struct Job
+    {
+        uint64_t conn_id;
+        uint64_t seq;
+        ::std::string payload;
+        Clock::time_point received;
+    };
+
+    struct Done
+    {
+        uint64_t conn_id;
+        uint64_t seq;
+        ::std::string frame;
+        Clock::time_point received;
+        size_t request_bytes;   // 请求负载的字节数，响应写入out时从连接的在途字节数中扣除
+    };
+
+    struct Connection
+    {
+        int fd = -1;
+        ::std::string in;                           // 未解析完的输入
+        ::std::string out;                          // 待发送的响应
+        size_t out_pos = 0;
+        uint64_t next_seq = 0;                      // 下一个请求的序号
+        uint64_t next_write_seq = 0;                // 下一个应写出的响应序号
+        ::std::map<uint64_t, Done> ready;           // 已完成但未轮到写出的响应
+        size_t pending = 0;                         // 尚未写入out的请求数
+        size_t pending_bytes = 0;                   // 这些请求的负载字节数
+        uint32_t events = EPOLLIN | EPOLLRDHUP;     // 当前在epoll中关注的事件
+        bool want_write = false;
+        bool read_closed = false;
+    };
+}
+
+
+struct SegServer::Impl {
+    Segmenter segmenter;
+    ServerOptions options;
+    ::std::atomic<bool> stopping{false};
+    int wake_fd = -1;
+    int epoll_fd = -1;
+    int listen_fd = -1;
+    bool owns_socket_path = false;  // Unix域套接字文件由本进程创建，退出时才删除
+
+    mutable ::std::mutex latency_mutex;
+    LatencyHistogram latency;
+
+    // 事件循环 -> 工作线程
+    ::std::mutex job_mutex;
+    ::std::condition_variable job_cv;
+    ::std::deque<::std::vector<Job>> job_queue;
+    bool workers_done = false;
+
+    // 工作线程 -> 事件循环
+    ::std::mutex done_mutex;
+    ::std::vector<Done> done_queue;
+
+    ::std::unordered_map<uint64_t, Connection> connections;
+    uint64_t next_conn_id = WAKE_ID + 1;
+    bool listener_paused = false;   // 文件描述符耗尽时暂停监听
+
+    ::std::vector<Job> batch;
+    size_t batch_bytes = 0;
+
+    Impl(Segmenter seg, ServerOptions opts) :
+    segmenter(::std::move(seg)), options(::std::move(opts)) {
+        wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (wake_fd < 0)
+            throw_errno("eventfd failed");
+    }
+
+    ~Impl() {
+        close_listener();
+        if (wake_fd >= 0)
+            close(wake_fd);
+    }
+
+    void wake() {
+        const uint64_t one = 1;
+        ssize_t ignored = write(wake_fd, &one, sizeof(one));
+        (void)ignored;
+    }
+
+    void open_listener() {
+        if (!options.unix_path.empty()) {
+            sockaddr_un addr{};
+            addr.sun_family = AF_UNIX;
+            if (options.unix_path.size() >= sizeof(addr.sun_path))
+                throw ::std::invalid_argument("Unix socket path too long");
+            ::std::memcpy(addr.sun_path, options.unix_path.c_str(), options.unix_path.size() + 1);
+            // 只删除残留的套接字文件，路径指向其它类型的文件时拒绝启动，以免误删数据
+            struct stat st{};
+            if (lstat(options.unix_path.c_str(), &st) == 0) {
+                if (!S_ISSOCK(st.st_mode))
+                    throw ::std::invalid_argument("Unix socket path exists and is not a socket: " + options.unix_path);
+                if (unlink(options.unix_path.c_str()) < 0)
+                    throw_errno("unlink stale socket failed");
+            } else if (errno != ENOENT) {
+                throw_errno("lstat socket path failed");
+            }
+            listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (listen_fd < 0)
+                throw_errno("socket failed");
+            if (bind(listen_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0)
+                throw_errno("bind failed");
+            owns_socket_path = true;
+        } else {
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(options.tcp_port);
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (listen_fd < 0)
+                throw_errno("socket failed");
+            const int on = 1;
+            setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+            if (bind(listen_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0)
+                throw_errno("bind failed");
+        }
+        if (::listen(listen_fd, SOMAXCONN) < 0)
+            throw_errno("listen failed");
+    }
+
+    void close_listener() {
+        if (listen_fd >= 0) {
+            close(listen_fd);
+            listen_fd = -1;
+        }
+        if (owns_socket_path) {
+            unlink(options.unix_path.c_str());
+            owns_socket_path = false;
+        }
+    }
+
+    // 打开监听套接字，已在监听时直接返回；失败时不留下半打开的套接字
+    void listen() {
+        if (listen_fd >= 0)
+            return;
+        try {
+            open_listener();
+        } catch (...) {
+            close_listener();
+            throw;
+        }
+    }
+
+    void watch(int fd, uint64_t id, uint32_t events, int op = EPOLL_CTL_ADD) {
+        epoll_event ev{};
+        ev.events = events;
+        ev.data.u64 = id;
+        if (epoll_ctl(epoll_fd, op, fd, &ev) < 0)
+            throw_errno("epoll_ctl failed");
+    }
+
+    void worker_loop() {
+        for (;;) {
+            ::std::vector<Job> jobs;
+            {
+                ::std::unique_lock<::std::mutex> lock(job_mutex);
+                job_cv.wait(lock, [this] { return !job_queue.empty() || workers_done; });
+                if (job_queue.empty())
+                    return;
+                jobs = ::std::move(job_queue.front());
+                job_queue.pop_front();
+            }
+
+            ::std::vector<Done> results;
+            results.reserve(jobs.size());
+            for (auto &job : jobs) {
+                Done done{job.conn_id, job.seq, ::std::string(), job.received, job.payload.size()};
+                try {
+                    // 请求来自网络，先替换非法的UTF-8序列，避免整句在编码转换时丢失
+                    sanitize_utf8(job.payload);
+                    seg_protocol::encode_response(done.frame, segmenter(job.payload));
+                } catch (const ::std::exception &e) {
+                    // 丢弃可能已写入一半的响应，改为返回错误状态
+                    done.frame.clear();
+                    seg_protocol::encode_error(done.frame, seg_protocol::STATUS_SEGMENT_ERROR, e.what());
+                }
+                results.push_back(::std::move(done));
+            }
+            {
+                ::std::lock_guard<::std::mutex> lock(done_mutex);
+                for (auto &done : results)
+                    done_queue.push_back(::std::move(done));
+            }
+            wake();
+        }
+    }
+
+    // 把当前批次交给工作线程
+    void dispatch() {
+        if (batch.empty())
+            return;
+        {
+            ::std::lock_guard<::std::mutex> lock(job_mutex);
+            job_queue.push_back(::std::move(batch));
+        }
+        job_cv.notify_one();
+        batch.clear();
+        batch_bytes = 0;
+    }
+
+    void enqueue(Job job) {
+        if (job.payload.size() > options.small_request_bytes) {
+            // 大请求单独成批，避免拖慢同批的小请求
+            ::std::vector<Job> single;
+            single.push_back(::std::move(job));
+            {
+                ::std::lock_guard<::std::mutex> lock(job_mutex);
+                job_queue.push_back(::std::move(single));
+            }
+            job_cv.notify_one();
+            return;
+        }
+        batch_bytes += job.payload.size();
+        batch.push_back(::std::move(job));
+        if (batch.size() >= options.max_batch_requests || batch_bytes >= options.max_batch_bytes)
+            dispatch();
+    }
+
+    // 在途请求数、在途请求字节数或积压响应达到上限时不再接收新请求
+    bool throttled(const Connection &conn) const {
+        return conn.pending >= options.max_pending_requests
+            || conn.pending_bytes >= options.max_pending_bytes
+            || conn.out.size() - conn.out_pos >= options.max_output_bytes;
+    }
+
+    // 按连接状态调整关注的事件，只在变化时调用epoll_ctl
+    void update_interest(uint64_t id, Connection &conn) {
+        uint32_t events = 0;
+        if (!conn.read_closed && !throttled(conn))
+            events |= EPOLLIN | EPOLLRDHUP;
+        if (conn.want_write)
+            events |= EPOLLOUT;
+        if (events == conn.events)
+            return;
+        watch(conn.fd, id, events, EPOLL_CTL_MOD);
+        conn.events = events;
+    }
+
+    // 监听套接字是水平触发的，描述符耗尽时accept一直失败而可读事件一直存在，
+    // 因此暂时不再关注它，等有连接关闭或超时后再恢复
+    void pause_listener() {
+        if (listener_paused)
+            return;
+        watch(listen_fd, LISTEN_ID, 0, EPOLL_CTL_MOD);
+        listener_paused = true;
+    }
+
+    void resume_listener() {
+        if (!listener_paused)
+            return;
+        watch(listen_fd, LISTEN_ID, EPOLLIN, EPOLL_CTL_MOD);
+        listener_paused = false;
+    }
+
+    void close_connection(uint64_t id) {
+        auto it = connections.find(id);
+        if (it == connections.end())
+            return;
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, it->second.fd, nullptr);
+        close(it->second.fd);
+        connections.erase(it);
+        resume_listener();
+    }
+
+    void accept_all() {
+        for (;;) {
+            const int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno == EINTR || errno == ECONNABORTED)
+                    continue;
+                if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM)
+                    pause_listener();
+                return;
+            }
+            if (options.unix_path.empty()) {
+                const int on = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+            }
+            const uint64_t id = next_conn_id++;
+            connections[id].fd = fd;
+            try {
+                watch(fd, id, EPOLLIN | EPOLLRDHUP);
+            } catch (...) {
+                close(fd);
+                connections.erase(id);
+                throw;
+            }
+        }
+    }
+
+    // 尽量写出发送缓冲区，返回false表示连接已关闭
+    bool flush_output(uint64_t id, Connection &conn) {
+        while (conn.out_pos < conn.out.size()) {
+            const ssize_t n = send(conn.fd, conn.out.data() + conn.out_pos,
+                conn.out.size() - conn.out_pos, MSG_NOSIGNAL);
+            if (n > 0) {
+                conn.out_pos += static_cast<size_t>(n);
+                continue;
+            }
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                conn.want_write = true;
+                return true;
+            }
+            close_connection(id);
+            return false;
+        }
+        conn.out.clear();
+        conn.out_pos = 0;
+        conn.want_write = false;
+        return true;
+    }
+
+    // 从输入缓冲区解析完整的请求帧并提交，达到在途上限时停止，返回false表示连接已关闭
+    bool parse_frames(uint64_t id, Connection &conn) {
+        const auto received = Clock::now();
+        size_t offset = 0;
+        while (!throttled(conn)) {
+            if (conn.in.size() - offset >= seg_protocol::HEADER_SIZE
+                && seg_protocol::read_u32(conn.in.data() + offset) > seg_protocol::MAX_FRAME_SIZE) {
+                close_connection(id);
+                return false;
+            }
+            const ::std::optional<uint32_t> length = seg_protocol::peek_frame(conn.in, offset);
+            if (!length.has_value())
+                break;
+            offset += seg_protocol::HEADER_SIZE;
+            enqueue(Job{id, conn.next_seq++, conn.in.substr(offset, length.value()), received});
+            ++conn.pending;
+            conn.pending_bytes += length.value();
+            offset += length.value();
+        }
+        conn.in.erase(0, offset);
+        return true;
+    }
+
+    // 连接状态变化后统一处理：提交已缓冲的请求、写出响应、判断是否可以关闭、调整关注的事件
+    void service(uint64_t id, Connection &conn) {
+        if (!parse_frames(id, conn))
+            return;
+        if (conn.out.size() > conn.out_pos && !flush_output(id, conn))
+            return;
+        // 对端已关闭写方向且所有请求都已响应时关闭连接
+        if (conn.read_closed && conn.pending == 0 && conn.out.empty()) {
+            close_connection(id);
+            return;
+        }
+        update_interest(id, conn);
+    }
+
+    // 读取请求直到无数据可读或触发反压，返回false表示连接已关闭
+    bool read_input(uint64_t id, Connection &conn) {
+        char buffer[READ_CHUNK];
+        while (!conn.read_closed && !throttled(conn)) {
+            const ssize_t n = recv(conn.fd, buffer, sizeof(buffer), 0);
+            if (n > 0) {
+                conn.in.append(buffer, static_cast<size_t>(n));
+                // 边读边解析，触发反压后剩余数据留在内核缓冲区
+                if (!parse_frames(id, conn))
+                    return false;
+                continue;
+            }
+            if (n == 0) {
+                // 对端关闭写方向后不再关注可读事件，处理完已收到的请求再关闭
+                conn.read_closed = true;
+                break;
+            }
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            close_connection(id);
+            return false;
+        }
+        return true;
+    }
+
+    // 取回工作线程的结果，按序号顺序写回各连接
+    void drain_completions() {
+        uint64_t counter;
+        while (read(wake_fd, &counter, sizeof(counter)) > 0) {}
+
+        ::std::vector<Done> finished;
+        {
+            ::std::lock_guard<::std::mutex> lock(done_mutex);
+            finished.swap(done_queue);
+        }
+
+        ::std::vector<uint64_t> touched;
+        for (auto &done : finished) {
+            auto it = connections.find(done.conn_id);
+            if (it == connections.end())
+                continue;
+            const uint64_t seq = done.seq;
+            it->second.ready.emplace(seq, ::std::move(done));
+            touched.push_back(it->first);
+        }
+
+        const auto now = Clock::now();
+        for (const uint64_t id : touched) {
+            auto it = connections.find(id);
+            if (it == connections.end())
+                continue;
+            Connection &conn = it->second;
+            {
+                ::std::lock_guard<::std::mutex> lock(latency_mutex);
+                while (!conn.ready.empty() && conn.ready.begin()->first == conn.next_write_seq) {
+                    Done &done = conn.ready.begin()->second;
+                    conn.out += done.frame;
+                    latency.record(static_cast<uint64_t>(
+                        ::std::chrono::duration_cast<::std::chrono::nanoseconds>(now - done.received).count()));
+                    conn.pending_bytes -= done.request_bytes;
+                    conn.ready.erase(conn.ready.begin());
+                    ++conn.next_write_seq;
+                    --conn.pending;
+                }
+            }
+            service(id, conn);
+        }
+    }
+
+    // 无论run正常返回还是抛出异常，都要停止并回收工作线程、关闭所有描述符
+    struct RunGuard
+    {
+        Impl &impl;
+        ::std::vector<::std::thread> workers;
+
+        ~RunGuard() {
+            {
+                ::std::lock_guard<::std::mutex> lock(impl.job_mutex);
+                impl.workers_done = true;
+            }
+            impl.job_cv.notify_all();
+            for (auto &worker : workers)
+                worker.join();
+
+            for (auto &entry : impl.connections)
+                close(entry.second.fd);
+            impl.connections.clear();
+            impl.listener_paused = false;
+            if (impl.epoll_fd >= 0) {
+                close(impl.epoll_fd);
+                impl.epoll_fd = -1;
+            }
+            impl.close_listener();
+        }
+    };
+
+    void run() {
+        RunGuard guard{*this, {}};
+        listen();
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd < 0)
+            throw_errno("epoll_create1 failed");
+        watch(listen_fd, LISTEN_ID, EPOLLIN);
+        watch(wake_fd, WAKE_ID, EPOLLIN);
+
+        size_t worker_count = options.workers;
+        if (worker_count == 0)
+            worker_count = ::std::max(1u, ::std::thread::hardware_concurrency());
+        for (size_t i = 0; i < worker_count; ++i)
+            guard.workers.emplace_back([this] { worker_loop(); });
+
+        epoll_event events[MAX_EVENTS];
+        while (!stopping.load()) {
+            const int n = epoll_wait(epoll_fd, events, MAX_EVENTS, POLL_TIMEOUT_MS);
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+                throw_errno("epoll_wait failed");
+            }
+            // 描述符可能被其它代码释放，超时后重新尝试接受连接
+            if (n == 0)
+                resume_listener();
+            for (int i = 0; i < n; ++i) {
+                const uint64_t id = events[i].data.u64;
+                if (id == LISTEN_ID) {
+                    accept_all();
+                    continue;
+                }
+                if (id == WAKE_ID) {
+                    drain_completions();
+                    continue;
+                }
+                auto it = connections.find(id);
+                if (it == connections.end())
+                    continue;
+                // 对端已完全关闭时剩余响应无法送达，直接关闭
+                if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                    close_connection(id);
+                    continue;
+                }
+                if ((events[i].events & (EPOLLIN | EPOLLRDHUP)) && !read_input(id, it->second))
+                    continue;
+                service(id, it->second);
+            }
+            // 本轮读到的小请求一起交给工作线程
+            dispatch();
+        }
+    }
+};
+
+
+SegServer::SegServer(Segmenter segmenter, ServerOptions options) :
+impl_(::std::make_unique<Impl>(::std::move(segmenter), ::std::move(options))) {}
+
+SegServer::~SegServer() = default;
+
+void SegServer::listen() {
+    impl_->listen();
+}
+
+void SegServer::run() {
+    impl_->run();
+}
+
+void SegServer::stop() {
+    impl_->stopping.store(true);
+    impl_->wake();
+}
+
+LatencyHistogram SegServer::latency() const {
+    ::std::lock_guard<::std::mutex> lock(impl_->latency_mutex);
+    return impl_->latency;
+}
+
+#else
+
+struct SegServer::Impl {
+    Segmenter segmenter;
+    ServerOptions options;
+    ::std::atomic<bool> stopping{false};
+    LatencyHistogram latency;
+};
+
+
+SegServer::SegServer(Segmenter segmenter, ServerOptions options) :
+impl_(::std::make_unique<Impl>()) {
+    impl_->segmenter = ::std::move(segmenter);
+    impl_->options = ::std::move(options);
+}
+
+SegServer::~SegServer() = default;
+
+void SegServer::listen() {
+    throw ::std::runtime_error("Server mode requires Linux (epoll)");
+}
+
+void SegServer::run() {
+    throw ::std::runtime_error("Server mode requires Linux (epoll)");
+}
+
+void SegServer::stop() {
+    impl_->stopping.store(true);
+}
+
+LatencyHistogram SegServer::latency() const {
+    return impl_->latency;
+}
+
+#endif
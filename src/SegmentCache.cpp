@@ -0,0 +1,233 @@
+#include "SegmentCache.h"
+#include <iostream>
+#include <cstring>
+#include <stdexcept>
+
+
+namespace
+{
+    // 每个条目在链表节点和索引节点上的额外开销（估算）
+    constexpr size_t ENTRY_OVERHEAD = 6 * sizeof(void *);
+
+    inline uint64_t rotl(uint64_t x, int r) {
+        return (x << r) | (x >> (64 - r));
+    }
+
+    inline uint64_t mix(uint64_t x) {
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ULL;
+        x ^= x >> 33;
+        return x;
+    }
+
+    void append_varint(::std::string &out, size_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+}
+
+
+SegmentCache::SegmentCache(size_t byte_budget, size_t shard_count) :
+byte_budget_(byte_budget),
+shard_count_(shard_count),
+shards_(::std::make_unique<Shard[]>(shard_count)) {
+    if (shard_count == 0)
+        throw ::std::invalid_argument("Shard count must be greater than zero");
+    if (byte_budget == 0)
+        throw ::std::invalid_argument("Byte budget must be greater than zero");
+}
+
+
+uint64_t SegmentCache::hash_bytes(const char *data, size_t length) {
+    constexpr uint64_t PRIME = 0x9e3779b97f4a7c15ULL;
+    uint64_t h = length * PRIME;
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        uint64_t word;
+        ::std::memcpy(&word, data + i, 8);
+        h = rotl(h ^ mix(word), 27) * PRIME;
+    }
+    uint64_t tail = 0;
+    ::std::memcpy(&tail, data + i, length - i);
+    h ^= mix(tail ^ PRIME);
+    return mix(h);
+}
+
+
+size_t SegmentCache::Entry::bytes() const {
+    return sizeof(Entry) + ENTRY_OVERHEAD + sentence.capacity() + spans.capacity();
+}
+
+
+SegmentCache::Shard &SegmentCache::shard_for(uint64_t hash) const {
+    // 高位选分片，低位留给分片内的哈希表
+    return shards_[(hash >> 48) % shard_count_];
+}
+
+
+void SegmentCache::remove(Shard &shard, ::std::list<Entry>::iterator it) {
+    const size_t entry_bytes = it->bytes();
+    shard.bytes -= entry_bytes;
+    total_bytes_.fetch_sub(entry_bytes, ::std::memory_order_relaxed);
+    shard.index.erase(it->hash);
+    shard.lru.erase(it);
+}
+
+
+::std::optional<::std::vector<::std::string>> SegmentCache::get(
+    const ::std::string &sentence,
+    uint64_t generation
+) {
+    const uint64_t hash = hash_bytes(sentence.data(), sentence.size());
+    Shard &shard = shard_for(hash);
+    ::std::vector<::std::string> words;
+    {
+        ::std::lock_guard<::std::mutex> lock(shard.mutex);
+        auto found = shard.index.find(hash);
+        if (found == shard.index.end() || found->second->sentence != sentence) {
+            misses_.fetch_add(1, ::std::memory_order_relaxed);
+            return ::std::nullopt;
+        }
+        auto it = found->second;
+        if (it->generation != generation) {
+            remove(shard, it);
+            invalidations_.fetch_add(1, ::std::memory_order_relaxed);
+            misses_.fetch_add(1, ::std::memory_order_relaxed);
+            return ::std::nullopt;
+        }
+        shard.lru.splice(shard.lru.begin(), shard.lru, it);
+
+        // 按变长编码的字节长度从原句中依次切出各词
+        size_t offset = 0;
+        size_t length = 0;
+        int shift = 0;
+        for (const char c : it->spans) {
+            const auto byte = static_cast<unsigned char>(c);
+            length |= static_cast<size_t>(byte & 0x7f) << shift;
+            if (byte & 0x80) {
+                shift += 7;
+                continue;
+            }
+            words.emplace_back(it->sentence, offset, length);
+            offset += length;
+            length = 0;
+            shift = 0;
+        }
+    }
+    hits_.fetch_add(1, ::std::memory_order_relaxed);
+    return words;
+}
+
+
+void SegmentCache::put(
+    const ::std::string &sentence,
+    const ::std::vector<::std::string> &words,
+    uint64_t generation
+) {
+    Entry entry;
+    entry.hash = hash_bytes(sentence.data(), sentence.size());
+    entry.generation = generation;
+    entry.sentence = sentence;
+
+    size_t offset = 0;
+    for (const auto &word : words) {
+        if (sentence.compare(offset, word.size(), word) != 0)
+            return;
+        append_varint(entry.spans, word.size());
+        offset += word.size();
+    }
+    if (offset != sentence.size())
+        return;
+    entry.spans.shrink_to_fit();
+
+    const size_t entry_bytes = entry.bytes();
+    if (entry_bytes > byte_budget_)
+        return;
+
+    Shard &shard = shard_for(entry.hash);
+    {
+        ::std::lock_guard<::std::mutex> lock(shard.mutex);
+        auto found = shard.index.find(entry.hash);
+        if (found != shard.index.end())
+            remove(shard, found->second);
+        while (!shard.lru.empty()
+            && total_bytes_.load(::std::memory_order_relaxed) + entry_bytes > byte_budget_) {
+            remove(shard, ::std::prev(shard.lru.end()));
+            evictions_.fetch_add(1, ::std::memory_order_relaxed);
+        }
+        shard.lru.push_front(::std::move(entry));
+        shard.index[shard.lru.front().hash] = shard.lru.begin();
+        shard.bytes += entry_bytes;
+        total_bytes_.fetch_add(entry_bytes, ::std::memory_order_relaxed);
+    }
+    if (total_bytes_.load(::std::memory_order_relaxed) > byte_budget_)
+        evict_others(shard);
+}
+
+
+void SegmentCache::evict_others(const Shard &skip) {
+    // 每次只持有一个分片的锁，避免分片之间互相等待
+    size_t idle = 0;
+    while (total_bytes_.load(::std::memory_order_relaxed) > byte_budget_ && idle < shard_count_) {
+        Shard &victim = shards_[evict_cursor_.fetch_add(1, ::std::memory_order_relaxed) % shard_count_];
+        if (&victim == &skip) {
+            ++idle;
+            continue;
+        }
+        ::std::lock_guard<::std::mutex> lock(victim.mutex);
+        if (victim.lru.empty()) {
+            ++idle;
+            continue;
+        }
+        remove(victim, ::std::prev(victim.lru.end()));
+        evictions_.fetch_add(1, ::std::memory_order_relaxed);
+        idle = 0;
+    }
+}
+
+
+void SegmentCache::clear(void) {
+    for (size_t i = 0; i < shard_count_; ++i) {
+        ::std::lock_guard<::std::mutex> lock(shards_[i].mutex);
+        total_bytes_.fetch_sub(shards_[i].bytes, ::std::memory_order_relaxed);
+        shards_[i].lru.clear();
+        shards_[i].index.clear();
+        shards_[i].bytes = 0;
+    }
+}
+
+
+SegmentCache::Stats SegmentCache::stats() const {
+    Stats result;
+    result.hits = hits_.load(::std::memory_order_relaxed);
+    result.misses = misses_.load(::std::memory_order_relaxed);
+    result.invalidations = invalidations_.load(::std::memory_order_relaxed);
+    result.evictions = evictions_.load(::std::memory_order_relaxed);
+    result.byte_budget = byte_budget_;
+    for (size_t i = 0; i < shard_count_; ++i) {
+        ::std::lock_guard<::std::mutex> lock(shards_[i].mutex);
+        result.entries += shards_[i].lru.size();
+        result.bytes += shards_[i].bytes;
+    }
+    return result;
+}
+
+
+void SegmentCache::info() const {
+    const Stats s = stats();
+    ::std::cout
+        << "SegmentCache Info:\n"
+        << "Shards: " << shard_count_
+        << ", Entries: " << s.entries
+        << ", Bytes: " << s.bytes << "/" << s.byte_budget << "\n"
+        << "Hits: " << s.hits
+        << ", Misses: " << s.misses
+        << " (Hit rate " << (s.hit_rate() * 100.0) << "%)\n"
+        << "Invalidations: " << s.invalidations
+        << ", Evictions: " << s.evictions << "\n\n";
+}
@@ -1,22 +1,57 @@
 #include "PreSplit.h"
+#include "SegServer.h"
+#include "Pipeline.h"
 #include <iostream>
 #include <fstream>
 #include <vector>
 #include <string>
 #include <chrono>
 #include <stdexcept>
+#include <csignal>
+#include <cstdlib>
+#ifdef _WIN32
 #include <windows.h>
+#endif
 
 namespace
 {
     constexpr const char *DATA_PATH = "data/dict.txt";
     constexpr const char *TEST_PATH = "data/demo.txt";
-    constexpr float ALPHA = 0.5f;
-    constexpr size_t LAYERS = 4;
-    constexpr size_t CAPACITY = 1e6;
+    constexpr size_t CACHE_BUDGET = 1 << 20; // 分词缓存字节预算
+    constexpr size_t SERVER_CACHE_BUDGET = 64 << 20; // 服务模式下的分词缓存字节预算
+
+    SegServer *running_server = nullptr;
+
+    void handle_stop_signal(int)
+    {
+        if (running_server != nullptr)
+            running_server->stop();
+    }
+
+    // 在服务运行期间登记信号处理，离开作用域时（包括抛出异常）撤销，避免信号访问已销毁的服务
+    struct StopSignalScope
+    {
+        explicit StopSignalScope(SegServer &server)
+        {
+            running_server = &server;
+            ::std::signal(SIGINT, handle_stop_signal);
+            ::std::signal(SIGTERM, handle_stop_signal);
+        }
+
+        ~StopSignalScope()
+        {
+            ::std::signal(SIGINT, SIG_DFL);
+            ::std::signal(SIGTERM, SIG_DFL);
+            running_server = nullptr;
+        }
+
+        StopSignalScope(const StopSignalScope&) = delete;
+        StopSignalScope &operator=(const StopSignalScope&) = delete;
+    };
 }
 
-void load_data(MultiHashTable<::std::string, ::std::string> &table)
+// 读取字典文件中的全部词条
+::std::vector<::std::pair<::std::string, ::std::string>> load_data()
 {
     ::std::ifstream file(DATA_PATH);
     if (!file.is_open())
@@ -24,6 +59,7 @@ void load_data(MultiHashTable<::std::string, ::std::string> &table)
         throw ::std::runtime_error("Failed to open dictionary file");
     }
 
+    ::std::vector<::std::pair<::std::string, ::std::string>> entries;
     ::std::string line;
     while (::std::getline(file, line))
     {
@@ -36,63 +72,136 @@ void load_data(MultiHashTable<::std::string, ::std::string> &table)
 
         ::std::string word = line.substr(0, separator_pos);
         ::std::string explanation = line.substr(separator_pos + 2);
-        table.insert(::std::move(::std::make_pair(::std::move(word), ::std::move(explanation))));
+        entries.emplace_back(::std::move(word), ::std::move(explanation));
     }
+    return entries;
 }
 
-::std::vector<::std::string> load_test()
+// 解析TCP端口号，只接受1~65535之间的十进制整数
+uint16_t parse_port(const ::std::string &value)
 {
-    ::std::ifstream file(TEST_PATH);
-    if (!file.is_open())
+    size_t parsed = 0;
+    unsigned long port = 0;
+    try
     {
-        throw ::std::runtime_error("Failed to open test file");
+        port = ::std::stoul(value, &parsed);
     }
+    catch (const ::std::exception &)
+    {
+        parsed = 0;
+    }
+    if (parsed == 0 || parsed != value.size() || value[0] == '-' || port == 0 || port > 65535)
+        throw ::std::invalid_argument("TCP port must be an integer between 1 and 65535: " + value);
+    return static_cast<uint16_t>(port);
+}
 
-    ::std::vector<::std::string> test_data;
-    ::std::string line;
-    while (::std::getline(file, line))
+
+// 解析服务模式参数：--serve unix:<路径> 或 --serve tcp:<端口>，可选 --workers <线程数>
+// 返回空表示以默认的批处理模式运行
+::std::optional<ServerOptions> parse_server_options(int argc, char *argv[])
+{
+    ::std::optional<ServerOptions> options;
+    for (int i = 1; i < argc; ++i)
     {
-        if (!line.empty())
+        const ::std::string arg = argv[i];
+        if (i + 1 >= argc)
+            throw ::std::invalid_argument("Missing value for " + arg);
+        const ::std::string value = argv[++i];
+        if (arg == "--serve")
+        {
+            if (!options.has_value())
+                options.emplace();
+            if (value.rfind("unix:", 0) == 0)
+                options->unix_path = value.substr(5);
+            else if (value.rfind("tcp:", 0) == 0)
+                options->tcp_port = parse_port(value.substr(4));
+            else
+                throw ::std::invalid_argument("Endpoint must be unix:<path> or tcp:<port>");
+        }
+        else if (arg == "--workers")
+        {
+            if (!options.has_value())
+                options.emplace();
+            options->workers = ::std::stoul(value);
+        }
+        else
         {
-            test_data.push_back(::std::move(line));
+            throw ::std::invalid_argument("Unknown argument " + arg);
         }
     }
-    return test_data;
+    if (options.has_value() && options->unix_path.empty() && options->tcp_port == 0)
+        throw ::std::invalid_argument("--serve is required in server mode");
+    return options;
+}
+
+
+// 常驻服务模式：只加载一次字典，之后通过套接字处理分词请求
+int serve(const ServerOptions &options)
+{
+    // 分词只需判断词是否存在，紧凑字典只保存键
+    const CompactDict dict(load_data(), false);
+    SegmentCache cache(SERVER_CACHE_BUDGET);
+
+    SegServer server(
+        [&dict, &cache](const ::std::string &sentence) {
+            return MaxiumSplit(dict, sentence, cache);
+        },
+        options
+    );
+    {
+        const StopSignalScope scope(server);
+        // 监听成功后才输出，等待该行的脚本此时一定可以连接
+        server.listen();
+        ::std::cout << "Serving on "
+            << (options.unix_path.empty() ? "tcp:127.0.0.1:" + ::std::to_string(options.tcp_port) : "unix:" + options.unix_path)
+            << ::std::endl;
+        server.run();
+    }
+
+    // 输出性能统计
+    server.latency().info("Request");
+    cache.info();
+    return 0;
 }
 
 
-int main() {
+int main(int argc, char *argv[]) {
+#ifdef _WIN32
     SetConsoleOutputCP(CP_UTF8);
+#endif
     try {
-        MultiHashTable<::std::string, ::std::string> table(CAPACITY, ALPHA, LAYERS);
-        load_data(table);
+        const ::std::optional<ServerOptions> server_options = parse_server_options(argc, argv);
+        if (server_options.has_value())
+            return serve(server_options.value());
+
+        // 分词只需判断词是否存在，紧凑字典只保存键
+        const CompactDict dict(load_data(), false);
+        SegmentCache cache(CACHE_BUDGET);
     
-        ::std::vector<::std::string> test_sentences = load_test();
-        ::std::vector<::std::vector<::std::string>> results;
-        results.reserve(test_sentences.size());
+        ::std::ifstream test_file(TEST_PATH);
+        if (!test_file.is_open())
+        {
+            throw ::std::runtime_error("Failed to open test file");
+        }
     
         const auto start_time = ::std::chrono::high_resolution_clock::now();
     
-        for (const auto &sentence : test_sentences)
-        {
-            results.push_back(MaxiumSplit(table, sentence));
-        }
+        // 读取、校验、分词与输出以流水线方式重叠进行
+        const PipelineReport report = run_pipeline(
+            test_file,
+            ::std::cout,
+            [&dict, &cache](const ::std::string &sentence) {
+                return MaxiumSplit(dict, sentence, cache);
+            }
+        );
     
         const auto end_time = ::std::chrono::high_resolution_clock::now();
         const auto duration = ::std::chrono::duration_cast<::std::chrono::microseconds>(end_time - start_time);
     
-        // 输出分词结果
-        for (const auto &segmentation : results)
-        {
-            for (const auto &word : segmentation)
-            {
-                ::std::cout << word << " ";
-            }
-            ::std::cout << "\n";
-        }
-    
         // 输出性能统计
-        table.info();
+        dict.info();
+        cache.info();
+        report.info();
         ::std::cout << "Total time: " << duration.count() << " μs\n";
     }
     catch (const ::std::exception& e) {
@@ -0,0 +1,259 @@
+// 字典存储格式的对比测试：MultiHashTable 与 CompactDict 的内存占用、查询延迟，
+// 以及前缀查询（CompactDict::prefix_range 对比 MultiHashTable 全表扫描）
+// 用法：DictBench [--dict <字典路径>] [--entries N]
+// 未指定字典文件时随机生成N个由常用汉字组成的1~4字词条。
+#include "MultiHashTable.h"
+#include "CompactDict.h"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <unordered_set>
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+    using Clock = ::std::chrono::high_resolution_clock;
+    using Entries = ::std::vector<::std::pair<::std::string, ::std::string>>;
+
+    constexpr float ALPHA = 0.5f;
+    constexpr size_t LAYERS = 4;
+    constexpr size_t MIN_CAPACITY = 1e6;  // 与原先main中的哈希表容量一致
+    constexpr size_t CJK_BASE = 0x4E00;
+    constexpr size_t CJK_POOL = 3500;  // 取前3500个汉字，接近常用字表规模
+    constexpr size_t PREFIX_LIMIT = 10;         // 前缀查询返回的词条数
+    constexpr size_t PREFIX_QUERIES = 10000;    // prefix_range的查询次数
+    constexpr size_t SCAN_QUERIES = 20;         // 全表扫描的查询次数
+
+    void append_utf8(::std::string &out, size_t code_point)
+    {
+        out.push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    }
+
+    ::std::string random_word(::std::mt19937 &rng, size_t min_chars, size_t max_chars)
+    {
+        ::std::uniform_int_distribution<size_t> length(min_chars, max_chars);
+        ::std::uniform_int_distribution<size_t> character(0, CJK_POOL - 1);
+        ::std::string word;
+        for (size_t i = length(rng); i > 0; --i)
+            append_utf8(word, CJK_BASE + character(rng));
+        return word;
+    }
+
+    Entries load_dict(const ::std::string &path)
+    {
+        ::std::ifstream file(path);
+        if (!file.is_open())
+            throw ::std::runtime_error("Failed to open dictionary file");
+        Entries entries;
+        ::std::string line;
+        while (::std::getline(file, line))
+        {
+            const size_t separator_pos = line.find("=>");
+            if (line.empty() || separator_pos == ::std::string::npos)
+                continue;
+            entries.emplace_back(line.substr(0, separator_pos), line.substr(separator_pos + 2));
+        }
+        return entries;
+    }
+
+    Entries generate_dict(size_t count, ::std::mt19937 &rng)
+    {
+        Entries entries;
+        entries.reserve(count);
+        ::std::unordered_set<::std::string> seen;
+        seen.reserve(count);
+        while (entries.size() < count)
+        {
+            ::std::string word = random_word(rng, 1, 4);
+            if (seen.insert(word).second)
+                entries.emplace_back(::std::move(word), "释义" + ::std::to_string(entries.size()));
+        }
+        return entries;
+    }
+
+    template <typename Func>
+    double time_per_op(const ::std::vector<::std::string> &queries, Func &&lookup, size_t &found)
+    {
+        found = 0;
+        const auto start = Clock::now();
+        for (const auto &query : queries)
+        {
+            if (lookup(query))
+                ++found;
+        }
+        const auto duration = ::std::chrono::duration_cast<::std::chrono::nanoseconds>(Clock::now() - start);
+        return static_cast<double>(duration.count()) / static_cast<double>(queries.size());
+    }
+
+    double elapsed_ms(Clock::time_point start)
+    {
+        return ::std::chrono::duration<double, ::std::milli>(Clock::now() - start).count();
+    }
+
+    // 无序哈希表只能扫描全部槽位收集匹配的键，再取字典序最小的limit个
+    ::std::vector<::std::string> scan_prefix(
+        const MultiHashTable<::std::string, ::std::string> &table,
+        const ::std::string &prefix,
+        size_t limit)
+    {
+        ::std::vector<::std::string> matches;
+        table.for_each([&](const ::std::string &key, const ::std::string &) {
+            if (key.compare(0, prefix.size(), prefix) == 0)
+                matches.push_back(key);
+        });
+        const size_t count = ::std::min(limit, matches.size());
+        ::std::partial_sort(matches.begin(), matches.begin() + count, matches.end());
+        matches.resize(count);
+        return matches;
+    }
+
+    ::std::vector<::std::string> range_prefix(const CompactDict &dict, const ::std::string &prefix, size_t limit)
+    {
+        ::std::vector<::std::string> matches;
+        for (const auto entry : dict.prefix_range(prefix, limit))
+            matches.emplace_back(entry.key);
+        return matches;
+    }
+}
+
+
+int main(int argc, char *argv[])
+{
+    try
+    {
+        ::std::string dict_path;
+        size_t entry_count = 1e6;
+        for (int i = 1; i + 1 < argc; i += 2)
+        {
+            const ::std::string arg = argv[i];
+            if (arg == "--dict")
+                dict_path = argv[i + 1];
+            else if (arg == "--entries")
+                entry_count = ::std::stoul(argv[i + 1]);
+            else
+                throw ::std::invalid_argument("Unknown argument " + arg);
+        }
+
+        ::std::mt19937 rng(42);
+        const Entries entries = dict_path.empty() ? generate_dict(entry_count, rng) : load_dict(dict_path);
+
+        // 一半查询命中、一半未命中，打乱顺序
+        ::std::vector<::std::string> queries;
+        queries.reserve(entries.size() * 2);
+        for (const auto &entry : entries)
+        {
+            queries.push_back(entry.first);
+            queries.push_back(random_word(rng, 5, 6));
+        }
+        ::std::shuffle(queries.begin(), queries.end(), rng);
+
+        ::std::cout << ::std::fixed << ::std::setprecision(2)
+            << "===== Dictionary Storage Benchmark =====\n"
+            << "Entries: " << entries.size() << ", Queries: " << queries.size() << "\n\n";
+
+        auto start = Clock::now();
+        MultiHashTable<::std::string, ::std::string> table(::std::max(entries.size(), MIN_CAPACITY), ALPHA, LAYERS);
+        for (const auto &entry : entries)
+            table.insert(entry);
+        const double table_build_ms = elapsed_ms(start);
+
+        start = Clock::now();
+        const CompactDict full_dict(entries, true);
+        const double full_build_ms = elapsed_ms(start);
+
+        start = Clock::now();
+        const CompactDict key_dict(entries, false);
+        const double key_build_ms = elapsed_ms(start);
+
+        size_t table_found = 0;
+        size_t full_found = 0;
+        size_t key_found = 0;
+        const double table_ns = time_per_op(queries,
+            [&table](const ::std::string &key) { return table.get(key).has_value(); }, table_found);
+        const double full_ns = time_per_op(queries,
+            [&full_dict](const ::std::string &key) { return full_dict.get(key).has_value(); }, full_found);
+        const double key_ns = time_per_op(queries,
+            [&key_dict](const ::std::string &key) { return key_dict.contains(key); }, key_found);
+
+        // 两种格式的查询结果必须一致
+        size_t mismatches = 0;
+        for (const auto &entry : entries)
+        {
+            const auto value = full_dict.get(entry.first);
+            if (!value.has_value() || value.value() != table.get(entry.first).value())
+                ++mismatches;
+        }
+
+        const auto report = [](const char *name, size_t bytes, double build_ms, double ns, size_t found) {
+            ::std::cout
+                << ::std::left << ::std::setw(24) << name << ::std::right
+                << "Memory=" << ::std::setw(10) << static_cast<double>(bytes) / (1 << 20) << " MiB"
+                << ", Build=" << ::std::setw(8) << build_ms << " ms"
+                << ", Lookup=" << ::std::setw(7) << ns << " ns/op"
+                << ", Hits=" << found << "\n";
+        };
+        report("MultiHashTable", table.memory_usage(), table_build_ms, table_ns, table_found);
+        report("CompactDict (values)", full_dict.memory_usage(), full_build_ms, full_ns, full_found);
+        report("CompactDict (keys)", key_dict.memory_usage(), key_build_ms, key_ns, key_found);
+        ::std::cout
+            << "\nMemory ratio (MultiHashTable / CompactDict values): "
+            << static_cast<double>(table.memory_usage()) / static_cast<double>(full_dict.memory_usage()) << "x\n"
+            << "Memory ratio (MultiHashTable / CompactDict keys):   "
+            << static_cast<double>(table.memory_usage()) / static_cast<double>(key_dict.memory_usage()) << "x\n"
+            << "Verification errors: " << mismatches << "\n";
+
+        // 前缀查询：以随机词条的前1~2个字为前缀，取字典序前PREFIX_LIMIT个
+        ::std::vector<::std::string> prefixes;
+        prefixes.reserve(PREFIX_QUERIES);
+        ::std::uniform_int_distribution<size_t> pick(0, entries.empty() ? 0 : entries.size() - 1);
+        for (size_t i = 0; i < PREFIX_QUERIES && !entries.empty(); ++i)
+        {
+            const ::std::string &key = entries[pick(rng)].first;
+            prefixes.push_back(key.substr(0, ::std::min(key.size(), static_cast<size_t>(3 * (1 + i % 2)))));
+        }
+
+        size_t prefix_errors = 0;
+        size_t range_results = 0;
+        start = Clock::now();
+        for (const auto &prefix : prefixes)
+            range_results += range_prefix(key_dict, prefix, PREFIX_LIMIT).size();
+        const double range_us = prefixes.empty() ? 0.0 : elapsed_ms(start) * 1000.0 / static_cast<double>(prefixes.size());
+
+        const size_t scan_count = ::std::min(SCAN_QUERIES, prefixes.size());
+        ::std::vector<::std::vector<::std::string>> scan_results;
+        scan_results.reserve(scan_count);
+        start = Clock::now();
+        for (size_t i = 0; i < scan_count; ++i)
+            scan_results.push_back(scan_prefix(table, prefixes[i], PREFIX_LIMIT));
+        const double scan_us = scan_count == 0 ? 0.0 : elapsed_ms(start) * 1000.0 / static_cast<double>(scan_count);
+
+        // 两种方式的前缀查询结果必须一致
+        for (size_t i = 0; i < scan_count; ++i)
+        {
+            if (scan_results[i] != range_prefix(key_dict, prefixes[i], PREFIX_LIMIT))
+                ++prefix_errors;
+        }
+
+        ::std::cout
+            << "\n-- Prefix Query (top " << PREFIX_LIMIT << ") --\n"
+            << "CompactDict::prefix_range: " << range_us << " us/query ("
+            << prefixes.size() << " queries, " << range_results << " results)\n"
+            << "MultiHashTable full scan:  " << scan_us << " us/query ("
+            << scan_count << " queries)\n"
+            << "Speedup: " << (range_us > 0 ? scan_us / range_us : 0.0) << "x\n"
+            << "Prefix verification errors: " << prefix_errors << "\n";
+        return mismatches == 0 && prefix_errors == 0 ? 0 : 1;
+    }
+    catch (const ::std::exception &e)
+    {
+        ::std::cerr << "Error: " << e.what() << ::std::endl;
+        return 1;
+    }
+}
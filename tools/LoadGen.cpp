@@ -0,0 +1,295 @@
+// 分词服务的压测客户端
+// 用法：LoadGen (--unix <路径> | --tcp <端口>) [--connections N] [--requests N] [--pipeline N] [--file <路径>]
+// 每个连接一个线程，保持pipeline个请求在途，统计客户端视角的吞吐量和延迟分位数。
+#include "SegProtocol.h"
+#include "LatencyHistogram.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <stdexcept>
+#include <cerrno>
+#include <cstring>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace
+{
+    using Clock = ::std::chrono::steady_clock;
+
+    struct Options
+    {
+        ::std::string unix_path;
+        uint16_t tcp_port = 0;
+        size_t connections = 4;
+        size_t requests = 10000;   // 每个连接发送的请求数
+        size_t pipeline = 16;      // 每个连接的在途请求数
+        ::std::string file = "data/demo.txt";
+    };
+
+    [[noreturn]] void throw_errno(const char *what)
+    {
+        throw ::std::runtime_error(::std::string(what) + ": " + ::std::strerror(errno));
+    }
+
+    // 关闭fd后抛出异常，错误信息取自关闭前的errno
+    [[noreturn]] void close_and_throw(int fd, const char *what)
+    {
+        const int error = errno;
+        close(fd);
+        errno = error;
+        throw_errno(what);
+    }
+
+    // 解析TCP端口号，只接受1~65535之间的十进制整数
+    uint16_t parse_port(const ::std::string &value)
+    {
+        size_t parsed = 0;
+        unsigned long port = 0;
+        try
+        {
+            port = ::std::stoul(value, &parsed);
+        }
+        catch (const ::std::exception &)
+        {
+            parsed = 0;
+        }
+        if (parsed == 0 || parsed != value.size() || value[0] == '-' || port == 0 || port > 65535)
+            throw ::std::invalid_argument("TCP port must be an integer between 1 and 65535: " + value);
+        return static_cast<uint16_t>(port);
+    }
+
+    Options parse_options(int argc, char *argv[])
+    {
+        Options options;
+        for (int i = 1; i < argc; ++i)
+        {
+            const ::std::string arg = argv[i];
+            if (i + 1 >= argc)
+                throw ::std::invalid_argument("Missing value for " + arg);
+            const ::std::string value = argv[++i];
+            if (arg == "--unix")
+                options.unix_path = value;
+            else if (arg == "--tcp")
+                options.tcp_port = parse_port(value);
+            else if (arg == "--connections")
+                options.connections = ::std::stoul(value);
+            else if (arg == "--requests")
+                options.requests = ::std::stoul(value);
+            else if (arg == "--pipeline")
+                options.pipeline = ::std::stoul(value);
+            else if (arg == "--file")
+                options.file = value;
+            else
+                throw ::std::invalid_argument("Unknown argument " + arg);
+        }
+        if (options.unix_path.empty() && options.tcp_port == 0)
+            throw ::std::invalid_argument("Either --unix or --tcp is required");
+        if (options.connections == 0 || options.pipeline == 0)
+            throw ::std::invalid_argument("Connections and pipeline must be greater than zero");
+        return options;
+    }
+
+    ::std::vector<::std::string> load_sentences(const ::std::string &path)
+    {
+        ::std::ifstream file(path);
+        if (!file.is_open())
+            throw ::std::runtime_error("Failed to open test file");
+        ::std::vector<::std::string> sentences;
+        ::std::string line;
+        while (::std::getline(file, line))
+        {
+            if (!line.empty())
+                sentences.push_back(::std::move(line));
+        }
+        if (sentences.empty())
+            throw ::std::runtime_error("Test file is empty");
+        return sentences;
+    }
+
+    int connect_to(const Options &options)
+    {
+        int fd;
+        if (!options.unix_path.empty())
+        {
+            sockaddr_un addr{};
+            addr.sun_family = AF_UNIX;
+            if (options.unix_path.size() >= sizeof(addr.sun_path))
+                throw ::std::invalid_argument("Unix socket path too long");
+            ::std::memcpy(addr.sun_path, options.unix_path.c_str(), options.unix_path.size() + 1);
+            fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (fd < 0)
+                throw_errno("socket failed");
+            if (connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0)
+                close_and_throw(fd, "connect failed");
+        }
+        else
+        {
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(options.tcp_port);
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            fd = socket(AF_INET, SOCK_STREAM, 0);
+            if (fd < 0)
+                throw_errno("socket failed");
+            if (connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0)
+                close_and_throw(fd, "connect failed");
+            const int on = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        }
+        return fd;
+    }
+
+    void send_all(int fd, const ::std::string &data)
+    {
+        size_t sent = 0;
+        while (sent < data.size())
+        {
+            const ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                throw_errno("send failed");
+            sent += static_cast<size_t>(n);
+        }
+    }
+
+    // 单个连接的压测循环，返回该连接的延迟直方图，errors累计服务端返回错误状态的请求数
+    LatencyHistogram run_connection(
+        const Options &options,
+        const ::std::vector<::std::string> &sentences,
+        size_t offset,
+        size_t &errors)
+    {
+        const int fd = connect_to(options);
+        LatencyHistogram histogram;
+        ::std::deque<Clock::time_point> in_flight;
+        ::std::string out;
+        ::std::string in;
+        size_t sent = 0;
+        size_t received = 0;
+        char buffer[64 * 1024];
+
+        try
+        {
+            while (received < options.requests)
+            {
+                // 补满在途窗口后一次性发出
+                out.clear();
+                const auto now = Clock::now();
+                while (sent < options.requests && in_flight.size() < options.pipeline)
+                {
+                    seg_protocol::encode_request(out, sentences[(offset + sent) % sentences.size()]);
+                    in_flight.push_back(now);
+                    ++sent;
+                }
+                if (!out.empty())
+                    send_all(fd, out);
+
+                const ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+                if (n < 0 && errno == EINTR)
+                    continue;
+                if (n < 0)
+                    throw_errno("recv failed");
+                if (n == 0)
+                    throw ::std::runtime_error("Server closed connection");
+                in.append(buffer, static_cast<size_t>(n));
+
+                size_t consumed = 0;
+                for (;;)
+                {
+                    const ::std::optional<uint32_t> length = seg_protocol::peek_frame(in, consumed);
+                    if (!length.has_value())
+                        break;
+                    const char *payload = in.data() + consumed + seg_protocol::HEADER_SIZE;
+                    const auto response = seg_protocol::decode_response(payload, length.value());
+                    if (!response.has_value())
+                        throw ::std::runtime_error("Malformed response");
+                    if (response->status != seg_protocol::STATUS_OK)
+                        ++errors;
+                    if (in_flight.empty())
+                        throw ::std::runtime_error("Unexpected response");
+                    histogram.record(static_cast<uint64_t>(
+                        ::std::chrono::duration_cast<::std::chrono::nanoseconds>(Clock::now() - in_flight.front()).count()));
+                    in_flight.pop_front();
+                    ++received;
+                    consumed += seg_protocol::HEADER_SIZE + length.value();
+                }
+                in.erase(0, consumed);
+            }
+        }
+        catch (...)
+        {
+            close(fd);
+            throw;
+        }
+        close(fd);
+        return histogram;
+    }
+}
+
+
+int main(int argc, char *argv[])
+{
+    try
+    {
+        const Options options = parse_options(argc, argv);
+        const ::std::vector<::std::string> sentences = load_sentences(options.file);
+
+        LatencyHistogram total;
+        ::std::mutex total_mutex;
+        ::std::string first_error;
+        size_t error_responses = 0;
+        ::std::vector<::std::thread> threads;
+
+        const auto start_time = Clock::now();
+        for (size_t i = 0; i < options.connections; ++i)
+        {
+            threads.emplace_back([&, i] {
+                try
+                {
+                    size_t errors = 0;
+                    LatencyHistogram histogram = run_connection(options, sentences, i, errors);
+                    ::std::lock_guard<::std::mutex> lock(total_mutex);
+                    total.merge(histogram);
+                    error_responses += errors;
+                }
+                catch (const ::std::exception &e)
+                {
+                    ::std::lock_guard<::std::mutex> lock(total_mutex);
+                    if (first_error.empty())
+                        first_error = e.what();
+                }
+            });
+        }
+        for (auto &thread : threads)
+            thread.join();
+        const auto duration = ::std::chrono::duration_cast<::std::chrono::microseconds>(Clock::now() - start_time);
+
+        if (!first_error.empty())
+            throw ::std::runtime_error(first_error);
+
+        ::std::cout
+            << "Connections: " << options.connections
+            << ", Pipeline: " << options.pipeline
+            << ", Requests: " << total.count()
+            << ", Error responses: " << error_responses << "\n"
+            << "Total time: " << duration.count() << " μs ("
+            << static_cast<double>(total.count()) * 1e6 / static_cast<double>(duration.count()) << " req/s)\n\n";
+        total.info("Client");
+    }
+    catch (const ::std::exception &e)
+    {
+        ::std::cerr << "Error: " << e.what() << ::std::endl;
+        return 1;
+    }
+    return 0;
+}